@@ -30,9 +30,19 @@
 
 #include "aojls.h"
 
-#include <setjmp.h>
 #include <float.h>
 
+// vector scanning of the input, define AOJLS_NO_SIMD to use scalar scanning only.
+// NEON scanning has not been verified on aarch64 yet, so it is only used if AOJLS_ENABLE_NEON is defined
+#if !defined(AOJLS_NO_SIMD) && defined(__GNUC__) && defined(__x86_64__)
+#define AOJLS_SIMD_X86
+#include <immintrin.h>
+#elif !defined(AOJLS_NO_SIMD) && defined(AOJLS_ENABLE_NEON) && defined(__GNUC__) && defined(__aarch64__) \
+		&& defined(__ARM_NEON)
+#define AOJLS_SIMD_NEON
+#include <arm_neon.h>
+#endif
+
 #define MAX_DOUBLE_LENGTH (4 + DBL_MANT_DIG + (-DBL_MIN_EXP))
 
 #define FAIL_ENOMEM 1
@@ -40,69 +50,159 @@
 #define FAIL_EXPECTED_VALUE 3
 #define FAIL_EXPECTED_EOO 4
 #define FAIL_EXPECTED_EOL 5
+#define FAIL_TOKENSTREAM 6
+#define FAIL_NO_VALUE 7
+#define FAIL_TOO_DEEP 8
+#define FAIL_SUSPENDED 9 // not an error, push parser needs more input
 
 // private struct implementations
 
-typedef struct _aojls_alloc_node _aojls_alloc_node_t;
+typedef union {
+	void*     p;
+	double    d;
+	long long l;
+} _aojls_align_t;
+
+#define ARENA_ALIGN (sizeof(_aojls_align_t))
+#define ARENA_ROUND(size) (((size) + ARENA_ALIGN - 1) / ARENA_ALIGN * ARENA_ALIGN)
+#define CHUNK_HEADER_SIZE ARENA_ROUND(sizeof(_aojls_chunk_t))
+#define CHUNK_DATA(chunk) ((char*)(chunk) + CHUNK_HEADER_SIZE)
 
-struct _aojls_alloc_node {
-	struct _aojls_alloc_node* next;
+typedef struct _aojls_chunk _aojls_chunk_t;
+
+struct _aojls_chunk {
+	struct _aojls_chunk* next;
+	size_t               size; // usable bytes after the header
+	size_t               used;
+	size_t               last; // offset of the last allocation, allows growing it in place
 };
 
+typedef struct {
+	const aojls_allocator_t* allocator;
+	_aojls_chunk_t* first;
+	_aojls_chunk_t* current;
+	size_t          chunk_size; // size of the next regular chunk
+} _aojls_arena_t;
+
 struct json_value{
-	_aojls_alloc_node_t anode;
 	json_type_t         type;
-	aojls_ctx_t*		ctx;
 };
 
+typedef union {
+	double        number;
+	int64_t       int64;
+	uint64_t      uint64;
+	char*         raw; // null terminated number text
+	bool          boolean;
+	json_value_t* ref; // JS_OBJECT, JS_ARRAY and JS_STRING
+} _aojls_payload_t;
+
+// representation of JSON number
+#define NUM_DOUBLE 0
+#define NUM_INT64 1
+#define NUM_UINT64 2 // only integers above INT64_MAX
+#define NUM_RAW 3 // source text, converted when read
+
+// 16 byte container slot. Numbers, booleans and null are stored inline and have
+// the same layout as their json_* structs, other values are referenced.
+typedef struct {
+	json_value_t     self;
+	int              kind; // NUM_* for numbers
+	_aojls_payload_t as;
+} _aojls_slot_t;
+
+typedef struct {
+	char*         key;
+	_aojls_slot_t value;
+} _aojls_member_t;
+
+// container of on demand deserialized document
+typedef struct {
+	size_t start; // offset of [ or { in the source
+	size_t end; // offset of matching ] or }
+	size_t next; // index of the first container after this one and its children
+} _aojls_span_t;
+
+typedef struct {
+	char*          source;
+	size_t         len;
+	_aojls_span_t* spans; // all containers, in document order
+	bool           lazy_numbers;
+} _aojls_document_t;
+
 struct json_object {
-	json_value_t   self;
-	size_t         allocated;
-	size_t		   n;
-	char**		   keys;
-	json_value_t** values;
+	json_value_t       self;
+	aojls_ctx_t*       ctx;
+	size_t             allocated;
+	size_t		       n;
+	_aojls_member_t*   members; // key is stored next to its value
+	_aojls_document_t* doc; // if set, members are not parsed yet
+	size_t             span;
 };
 
 struct json_array {
-	json_value_t   self;
-	size_t         allocated;
-	size_t		   n;
-	json_value_t** elements;
+	json_value_t       self;
+	aojls_ctx_t*       ctx;
+	size_t             allocated;
+	size_t		       n;
+	_aojls_slot_t*     elements;
+	_aojls_document_t* doc; // if set, elements are not parsed yet
+	size_t             span;
 };
 
 struct json_string {
 	json_value_t self;
-	char*		 value; // null terminated, always
+	bool         borrowed; // value points into deserialization source and is not null terminated
+	bool         escaped; // borrowed value still contains escape sequences
+	char*		 value; // null terminated, unless borrowed
+	size_t       len;
+	char         data[]; // at least AOJLS_STRING_INLINE_SIZE, value points here, owning context if borrowed
 };
 
 struct json_number {
-	json_value_t self;
-	double       value;
+	json_value_t     self;
+	int              kind;
+	_aojls_payload_t as;
 };
 
 struct json_boolean {
-	json_value_t self;
-	bool		 value;
+	json_value_t     self;
+	int              kind;
+	_aojls_payload_t as;
 };
 
 struct json_null {
-	json_value_t self;
+	json_value_t     self;
+	int              kind;
+	_aojls_payload_t as;
 };
 
-typedef struct char_node {
-	struct char_node* next;
-	char*  data;
-} char_node_t;
+typedef struct {
+	char*  key;
+	size_t len;
+	size_t hash;
+} _aojls_intern_entry_t;
 
 struct aojls_ctx {
-	_aojls_alloc_node_t* snode;
-	_aojls_alloc_node_t* enode;
+	aojls_allocator_t    allocator;
+	_aojls_arena_t       arena;
+	_aojls_arena_t       scratch; // temporary buffers of deserialization
 
 	json_value_t*        result;
 	bool				 failed;
-
-	char_node_t* ssnode;
-	char_node_t* esnode;
+	bool                 frozen;
+	aojls_ctx_stats_t    stats; // counters, byte totals are computed on demand
+
+	// shared immutable values, live as long as the context
+	json_boolean         true_value;
+	json_boolean         false_value;
+	json_null            null_value;
+
+	bool                   intern_keys;
+	size_t                 uninterned; // keys stored while interning was disabled
+	_aojls_intern_entry_t* itable;     // open addressing, capacity is power of 2
+	size_t                 icapacity;
+	size_t                 icount;
 };
 
 // json value
@@ -127,29 +227,87 @@ json_array* json_as_array(json_value_t* value) {
 		return NULL;
 }
 
+static void raw_to_number(const char* raw, _aojls_slot_t* slot);
+
+static inline json_number* number_value(json_number* n, _aojls_slot_t* converted) {
+	// raw numbers are converted on every read, so their text stays for serialization
+	if (n->kind != NUM_RAW)
+		return n;
+	raw_to_number(n->as.raw, converted);
+	return (json_number*)converted;
+}
+
 double json_as_number(json_value_t* value, bool* correct_type) {
 	if (value != NULL && value->type == JS_NUMBER) {
 		if (correct_type != NULL)
 			*correct_type = true;
-		return ((json_number*)value)->value;
+		_aojls_slot_t converted;
+		json_number* n = number_value((json_number*)value, &converted);
+		switch (n->kind) {
+		case NUM_INT64:
+			return (double)n->as.int64;
+		case NUM_UINT64:
+			return (double)n->as.uint64;
+		default:
+			return n->as.number;
+		}
 	} else
 		if (correct_type != NULL)
 			*correct_type = false;
 	return 0;
 }
 
+int64_t json_as_int64(json_value_t* value, bool* correct_type) {
+	if (value != NULL && value->type == JS_NUMBER) {
+		_aojls_slot_t converted;
+		json_number* n = number_value((json_number*)value, &converted);
+		switch (n->kind) {
+		case NUM_INT64:
+			if (correct_type != NULL)
+				*correct_type = true;
+			return n->as.int64;
+		case NUM_DOUBLE:
+			// integral doubles are accepted, 2^63 itself is out of range
+			if (n->as.number >= -9223372036854775808.0 && n->as.number < 9223372036854775808.0
+					&& n->as.number == (double)(int64_t)n->as.number) {
+				if (correct_type != NULL)
+					*correct_type = true;
+				return (int64_t)n->as.number;
+			}
+			break;
+		}
+	}
+	if (correct_type != NULL)
+		*correct_type = false;
+	return 0;
+}
+
+static bool string_own(json_string* s);
+
 char* json_as_string(json_value_t* value) {
-	if (value != NULL && value->type == JS_STRING)
+	if (value != NULL && value->type == JS_STRING && string_own((json_string*)value))
 		return ((json_string*)value)->value;
 	else
 		return NULL;
 }
 
+const char* json_as_nstring(json_value_t* value, size_t* len) {
+	if (value != NULL && value->type == JS_STRING) {
+		json_string* s = (json_string*)value;
+		if (s->escaped && !string_own(s))
+			return NULL;
+		if (len != NULL)
+			*len = s->len;
+		return s->value;
+	} else
+		return NULL;
+}
+
 bool json_as_bool(json_value_t* value, bool* correct_type) {
 	if (value != NULL && value->type == JS_BOOL) {
 		if (correct_type != NULL)
 			*correct_type = true;
-		return ((json_boolean*)value)->value;
+		return ((json_boolean*)value)->as.boolean;
 	} else
 		if (correct_type != NULL)
 			*correct_type = false;
@@ -163,57 +321,365 @@ bool json_is_null(json_value_t* value) {
 		return false;
 }
 
-// auxiliary functions
+// memory
 
-static void append_to_context(aojls_ctx_t* ctx, json_value_t* v) {
-	if (v == NULL || ctx == NULL) {
-		if (ctx != NULL)
-			ctx->failed = true;
+static void* default_malloc(size_t size, void* allocator_data) {
+	(void)allocator_data;
+	return malloc(size);
+}
+
+static void* default_realloc(void* ptr, size_t size, void* allocator_data) {
+	(void)allocator_data;
+	return realloc(ptr, size);
+}
+
+static void default_free(void* ptr, void* allocator_data) {
+	(void)allocator_data;
+	free(ptr);
+}
+
+static const aojls_allocator_t default_allocator = {
+	default_malloc, default_realloc, default_free, NULL
+};
+
+static inline void* mem_malloc(const aojls_allocator_t* allocator, size_t size) {
+	return allocator->malloc_function(size, allocator->allocator_data);
+}
+
+static inline void* mem_calloc(const aojls_allocator_t* allocator, size_t size) {
+	void* ptr = allocator->malloc_function(size, allocator->allocator_data);
+	if (ptr != NULL)
+		memset(ptr, 0, size);
+	return ptr;
+}
+
+static inline void* mem_realloc(const aojls_allocator_t* allocator, void* ptr, size_t size) {
+	return allocator->realloc_function(ptr, size, allocator->allocator_data);
+}
+
+static inline void mem_free(const aojls_allocator_t* allocator, void* ptr) {
+	if (ptr != NULL)
+		allocator->free_function(ptr, allocator->allocator_data);
+}
+
+// arena
+
+static _aojls_chunk_t* arena_new_chunk(_aojls_arena_t* arena, size_t size) {
+	_aojls_chunk_t* chunk = (_aojls_chunk_t*)mem_malloc(arena->allocator, CHUNK_HEADER_SIZE + size);
+	if (chunk == NULL)
+		return NULL;
+	chunk->next = NULL;
+	chunk->size = size;
+	chunk->used = 0;
+	chunk->last = 0;
+	return chunk;
+}
+
+static void* arena_alloc(_aojls_arena_t* arena, size_t size) {
+	size = ARENA_ROUND(size);
+
+	_aojls_chunk_t* chunk = arena->current;
+	if (chunk == NULL || chunk->size - chunk->used < size) {
+		if (chunk != NULL && chunk->next != NULL && chunk->next->size - chunk->next->used >= size) {
+			// chunk retained from before, reuse it
+			chunk = chunk->next;
+			arena->current = chunk;
+		} else {
+			size_t csize = arena->chunk_size;
+			if (csize == 0)
+				csize = AOJLS_ARENA_CHUNK_SIZE;
+			bool oversized = size > csize / 2;
+			if (oversized)
+				csize = size;
+			_aojls_chunk_t* nc = arena_new_chunk(arena, csize);
+			if (nc == NULL)
+				return NULL;
+			if (chunk == NULL) {
+				nc->next = arena->first;
+				arena->first = nc;
+			} else {
+				nc->next = chunk->next;
+				chunk->next = nc;
+			}
+
+			if (oversized && chunk != NULL) {
+				// dedicated chunk, keep filling the current one
+				nc->used = size;
+				return CHUNK_DATA(nc);
+			}
+
+			chunk = nc;
+			arena->current = chunk;
+			if (!oversized) {
+				arena->chunk_size = csize * 2;
+				if (arena->chunk_size > AOJLS_ARENA_MAX_CHUNK_SIZE)
+					arena->chunk_size = AOJLS_ARENA_MAX_CHUNK_SIZE;
+			}
+		}
+	}
+
+	chunk->last = chunk->used;
+	chunk->used += size;
+	return CHUNK_DATA(chunk) + chunk->last;
+}
+
+static void* arena_realloc(_aojls_arena_t* arena, void* ptr, size_t oldsize, size_t size) {
+	if (ptr == NULL)
+		return arena_alloc(arena, size);
+
+	_aojls_chunk_t* chunk = arena->current;
+	if ((char*)ptr == CHUNK_DATA(chunk) + chunk->last
+			&& ARENA_ROUND(size) <= chunk->size - chunk->last) {
+		// last allocation in the chunk, grow in place
+		chunk->used = chunk->last + ARENA_ROUND(size);
+		return ptr;
+	}
+
+	void* nptr = arena_alloc(arena, size);
+	if (nptr == NULL)
+		return NULL;
+	memcpy(nptr, ptr, oldsize < size ? oldsize : size);
+	return nptr;
+}
+
+static bool arena_reserve(_aojls_arena_t* arena, size_t size) {
+	// makes sure next allocations of up to size bytes are contiguous
+	size = ARENA_ROUND(size);
+	_aojls_chunk_t* chunk = arena->current;
+	if (chunk != NULL && chunk->size - chunk->used >= size)
+		return true;
+	if (chunk != NULL && chunk->next != NULL && chunk->next->size - chunk->next->used >= size) {
+		arena->current = chunk->next;
+		return true;
+	}
+
+	size_t csize = arena->chunk_size;
+	if (csize < size)
+		csize = size;
+	if (csize == 0)
+		csize = AOJLS_ARENA_CHUNK_SIZE;
+	_aojls_chunk_t* nc = arena_new_chunk(arena, csize);
+	if (nc == NULL)
+		return false;
+	if (chunk == NULL) {
+		nc->next = arena->first;
+		arena->first = nc;
+	} else {
+		nc->next = chunk->next;
+		chunk->next = nc;
+	}
+	arena->current = nc;
+	return true;
+}
+
+static void arena_free(_aojls_arena_t* arena, void* ptr) {
+	_aojls_chunk_t* chunk = arena->current;
+	if (ptr != NULL && (char*)ptr == CHUNK_DATA(chunk) + chunk->last) {
+		// last allocation in the chunk, give the space back
+		chunk->used = chunk->last;
+	}
+}
+
+static void arena_release(_aojls_arena_t* arena) {
+	_aojls_chunk_t* chunk = arena->first;
+	while (chunk != NULL) {
+		_aojls_chunk_t* next = chunk->next;
+		mem_free(arena->allocator, chunk);
+		chunk = next;
+	}
+	arena->first = NULL;
+	arena->current = NULL;
+	arena->chunk_size = 0;
+}
+
+static void arena_reset(_aojls_arena_t* arena) {
+	if (arena->first == NULL)
 		return;
+
+	if (arena->first->next != NULL) {
+		// coalesce into single chunk, so that same workload fits without allocation next time
+		size_t total = 0;
+		for (_aojls_chunk_t* chunk = arena->first; chunk != NULL; chunk = chunk->next)
+			total += chunk->size;
+		size_t chunk_size = arena->chunk_size;
+		arena_release(arena);
+		arena->first = arena_new_chunk(arena, total);
+		arena->current = arena->first;
+		arena->chunk_size = chunk_size;
+		return;
+	}
+
+	arena->first->used = 0;
+	arena->first->last = 0;
+	arena->current = arena->first;
+}
+
+static void arena_stats(_aojls_arena_t* arena, size_t* used, size_t* total) {
+	for (_aojls_chunk_t* chunk = arena->first; chunk != NULL; chunk = chunk->next) {
+		*used += chunk->used;
+		*total += CHUNK_HEADER_SIZE + chunk->size;
+	}
+}
+
+// auxiliary functions
+
+static json_value_t* make_value(aojls_ctx_t* ctx, size_t size, json_type_t type) {
+	json_value_t* v = (json_value_t*)arena_alloc(&ctx->arena, size);
+	if (v == NULL) {
+		ctx->failed = true;
+		return NULL;
 	}
-	if (ctx->enode == NULL) {
-		ctx->snode = &v->anode;
-		ctx->enode = &v->anode;
+	memset(v, 0, size);
+	v->type = type;
+	++ctx->stats.count[type];
+	return v;
+}
+
+static inline bool is_inline_type(json_type_t type) {
+	return type == JS_NUMBER || type == JS_BOOL || type == JS_NULL;
+}
+
+static inline void slot_store(_aojls_slot_t* slot, json_value_t* value) {
+	if (is_inline_type(value->type)) {
+		*slot = *(_aojls_slot_t*)value;
 	} else {
-		ctx->enode->next = &v->anode;
-		ctx->enode = &v->anode;
+		slot->self.type = value->type;
+		slot->as.ref = value;
+	}
+}
+
+static inline json_value_t* slot_value(_aojls_slot_t* slot) {
+	if (is_inline_type(slot->self.type))
+		return &slot->self;
+	return slot->as.ref;
+}
+
+static json_value_t* slot_detach(aojls_ctx_t* ctx, _aojls_slot_t* slot) {
+	// value of a slot that does not live in any container
+	switch (slot->self.type) {
+	case JS_NUMBER: {
+		_aojls_slot_t* v = (_aojls_slot_t*)arena_alloc(&ctx->arena, sizeof(_aojls_slot_t));
+		if (v == NULL) {
+			ctx->failed = true;
+			return NULL;
+		}
+		*v = *slot;
+		return &v->self;
+	}
+	case JS_BOOL:
+		return slot->as.boolean ? &ctx->true_value.self : &ctx->false_value.self;
+	case JS_NULL:
+		return &ctx->null_value.self;
+	default:
+		return slot->as.ref;
 	}
-	v->anode.next = NULL;
-	v->ctx = ctx;
 }
 
-static char* append_string(aojls_ctx_t* ctx, char* string, size_t len) {
+static char* append_string(aojls_ctx_t* ctx, const char* string, size_t len) {
 	if (ctx == NULL || string == NULL) {
 		if (ctx != NULL)
 			ctx->failed = true;
 		return NULL;
 	}
 
-	char* cpy = (char*)malloc((len+1) * sizeof(char));
+	char* cpy = (char*)arena_alloc(&ctx->arena, (len+1) * sizeof(char));
 	if (cpy == NULL) {
 		ctx->failed = true;
 		return NULL;
 	}
+	memcpy(cpy, string, len);
 	cpy[len] = '\0';
-	char_node_t* cnode = (char_node_t*)calloc(1, sizeof(char_node_t));
-	if (cnode == NULL) {
-		free(cpy);
-		ctx->failed = true;
-		return NULL;
+	return cpy;
+}
+
+// key interning
+
+static size_t hash_key(const char* key, size_t len) {
+	// FNV-1a
+	size_t hash = (size_t)14695981039346656037ULL;
+	for (size_t i=0; i<len; i++) {
+		hash ^= (unsigned char)key[i];
+		hash *= (size_t)1099511628211ULL;
 	}
+	return hash;
+}
 
-	memcpy(cpy, string, len);
-	cnode->data = cpy;
+static _aojls_intern_entry_t* intern_slot(aojls_ctx_t* ctx, const char* key, size_t len, size_t hash) {
+	size_t mask = ctx->icapacity - 1;
+	for (size_t i = hash & mask;; i = (i + 1) & mask) {
+		_aojls_intern_entry_t* e = &ctx->itable[i];
+		if (e->key == NULL)
+			return e;
+		if (e->hash == hash && e->len == len && memcmp(e->key, key, len) == 0)
+			return e;
+	}
+}
 
-	if (ctx->esnode == NULL) {
-		ctx->esnode = cnode;
-		ctx->ssnode = cnode;
-	} else {
-		ctx->esnode->next = cnode;
-		ctx->esnode = cnode;
+static char* intern_find(aojls_ctx_t* ctx, const char* key, size_t len) {
+	if (ctx->icount == 0)
+		return NULL;
+	return intern_slot(ctx, key, len, hash_key(key, len))->key;
+}
+
+static char* intern_key(aojls_ctx_t* ctx, const char* key, size_t len) {
+	if ((ctx->icount + 1) * 4 > ctx->icapacity * 3) {
+		size_t capacity = ctx->icapacity == 0 ? 64 : ctx->icapacity * 2;
+		_aojls_intern_entry_t* table = (_aojls_intern_entry_t*)arena_alloc(&ctx->arena,
+				capacity * sizeof(_aojls_intern_entry_t));
+		if (table == NULL) {
+			ctx->failed = true;
+			return NULL;
+		}
+		memset(table, 0, capacity * sizeof(_aojls_intern_entry_t));
+
+		_aojls_intern_entry_t* old = ctx->itable;
+		size_t oldcapacity = ctx->icapacity;
+		ctx->itable = table;
+		ctx->icapacity = capacity;
+		for (size_t i=0; i<oldcapacity; i++) {
+			if (old[i].key != NULL) {
+				size_t mask = capacity - 1;
+				size_t j = old[i].hash & mask;
+				while (table[j].key != NULL)
+					j = (j + 1) & mask;
+				table[j] = old[i];
+			}
+		}
 	}
 
-	return cpy;
+	size_t hash = hash_key(key, len);
+	_aojls_intern_entry_t* e = intern_slot(ctx, key, len, hash);
+	if (e->key == NULL) {
+		char* cpy = append_string(ctx, key, len);
+		if (cpy == NULL)
+			return NULL;
+		e->key = cpy;
+		e->len = len;
+		e->hash = hash;
+		++ctx->icount;
+		ctx->stats.key_bytes += len;
+	}
+	return e->key;
+}
+
+static char* store_key(aojls_ctx_t* ctx, const char* key, size_t len) {
+	if (ctx->intern_keys)
+		return intern_key(ctx, key, len);
+	++ctx->uninterned;
+	ctx->stats.key_bytes += len;
+	return append_string(ctx, key, len);
+}
+
+// on demand deserialized containers are parsed on first access
+
+static bool load_container(json_value_t* container);
+
+static inline bool object_loaded(json_object* o) {
+	return o->doc == NULL || load_container(&o->self);
+}
+
+static inline bool array_loaded(json_array* a) {
+	return a->doc == NULL || load_container(&a->self);
 }
 
 // json object
@@ -221,30 +687,20 @@ static char* append_string(aojls_ctx_t* ctx, char* string, size_t len) {
 json_object* json_make_object(aojls_ctx_t* ctx) {
 	if (ctx == NULL)
 		return NULL;
-	json_object* o = (json_object*)calloc(1, sizeof(json_object));
-	if (o == NULL) {
-		ctx->failed = true;
+	json_object* o = (json_object*)make_value(ctx, sizeof(json_object), JS_OBJECT);
+	if (o == NULL)
 		return NULL;
-	}
 
-	o->self.type = JS_OBJECT;
+	o->ctx = ctx;
 	o->allocated = AOJLS_OBJECT_START_ALLOC_SIZE;
 	o->n = 0;
-	o->keys = (char**)malloc(o->allocated*sizeof(char*));
-	if (o->keys == NULL) {
-		free(o);
-		ctx->failed = true;
-		return NULL;
-	}
-	o->values = (json_value_t**)malloc(o->allocated*sizeof(json_value_t*));
-	if (o->values == NULL) {
-		free(o->keys);
-		free(o);
+	ctx->stats.container_slack += o->allocated;
+	o->members = (_aojls_member_t*)arena_alloc(&ctx->arena, o->allocated*sizeof(_aojls_member_t));
+	if (o->members == NULL) {
 		ctx->failed = true;
 		return NULL;
 	}
 
-	append_to_context(ctx, &o->self);
 	return o;
 }
 
@@ -254,66 +710,100 @@ json_object* json_object_add(json_object* o, const char* key, json_value_t* valu
 	return json_object_nadd(o, key, strlen(key), value);
 }
 
-json_object* json_object_nadd(json_object* o, const char* key, size_t len, json_value_t* value) {
-	if (o == NULL || value == NULL || key == NULL) {
-		if (o != NULL)
-			o->self.ctx->failed = true;
+static json_object* object_put(json_object* o, char* key, _aojls_slot_t* value) {
+	if (o->ctx->frozen) {
+		o->ctx->failed = true;
 		return NULL;
 	}
+	if (!object_loaded(o))
+		return NULL;
 
 	if (o->n == o->allocated) {
 		// reallocate and increase the size
-		size_t allocated = o->allocated * 2;
-		char** keys = (char**)realloc(o->keys, allocated*sizeof(char*));
-		if (keys == NULL) {
-			o->self.ctx->failed = true;
-			return NULL;
-		}
-		json_value_t** values = (json_value_t**)realloc(o->values, allocated*sizeof(json_value_t*));
-		if (values == NULL) {
-			free(keys);
-			o->self.ctx->failed = true;
+		size_t allocated = o->allocated == 0 ? AOJLS_OBJECT_START_ALLOC_SIZE : o->allocated * 2;
+		_aojls_member_t* members = (_aojls_member_t*)arena_realloc(&o->ctx->arena, o->members,
+				o->allocated*sizeof(_aojls_member_t), allocated*sizeof(_aojls_member_t));
+		if (members == NULL) {
+			o->ctx->failed = true;
 			return NULL;
 		}
+		o->ctx->stats.container_slack += allocated - o->allocated;
 		o->allocated = allocated;
-		o->keys = keys;
-		o->values = values;
+		o->members = members;
 	}
 
-	key = append_string(o->self.ctx, key, len);
-	if (key == NULL) {
-		o->self.ctx->failed = true;
+	o->members[o->n].key = key;
+	o->members[o->n].value = *value;
+	++o->n;
+	--o->ctx->stats.container_slack;
+
+	return o;
+}
+
+static json_object* object_add(json_object* o, const char* key, size_t len, _aojls_slot_t* value) {
+	if (o->ctx->frozen) {
+		o->ctx->failed = true;
 		return NULL;
 	}
 
-	o->keys[o->n] = key;
-	o->values[o->n] = value;
-	++o->n;
+	char* kcopy = store_key(o->ctx, key, len);
+	if (kcopy == NULL) {
+		o->ctx->failed = true;
+		return NULL;
+	}
+	return object_put(o, kcopy, value);
+}
 
-	return o;
+json_object* json_object_nadd(json_object* o, const char* key, size_t len, json_value_t* value) {
+	if (o == NULL || value == NULL || key == NULL) {
+		if (o != NULL)
+			o->ctx->failed = true;
+		return NULL;
+	}
+
+	_aojls_slot_t slot;
+	slot_store(&slot, value);
+	return object_add(o, key, len, &slot);
 }
 
 size_t json_object_numkeys(json_object* o) {
-	if (o == NULL)
+	if (o == NULL || !object_loaded(o))
 		return 0;
 	return o->n;
 }
 
 char* json_object_get_key(json_object* o, size_t i) {
-	if (o == NULL || i >= o->n)
+	if (o == NULL || !object_loaded(o) || i >= o->n)
 		return NULL;
-	return o->keys[i];
+	return o->members[i].key;
 }
 
 json_value_t* json_object_get_object_as_value(json_object* o, const char* key) {
 	if (o == NULL || key == NULL) {
 		if (o != NULL)
-			o->self.ctx->failed = true;
+			o->ctx->failed = true;
+		return NULL;
+	}
+	if (!object_loaded(o))
+		return NULL;
+
+	aojls_ctx_t* ctx = o->ctx;
+	if (ctx->intern_keys && ctx->uninterned == 0) {
+		// every key in this context is interned, pointer comparison is enough
+		char* ikey = intern_find(ctx, key, strlen(key));
+		if (ikey == NULL)
+			return NULL;
+		for (size_t i=0; i<o->n; i++) {
+			if (o->members[i].key == ikey) {
+				return slot_value(&o->members[i].value);
+			}
+		}
 		return NULL;
 	}
+
 	for (size_t i=0; i<o->n; i++) {
-		if (strcmp(key, o->keys[i]) == 0) {
-			return o->values[i];
+		if (strcmp(key, o->members[i].key) == 0) {
+			return slot_value(&o->members[i].value);
 		}
 	}
 	return NULL; // not found
@@ -345,6 +835,24 @@ double json_object_get_double(json_object* o, const char* key, bool* valid) {
 	return json_as_number(value, valid);
 }
 
+int64_t json_object_get_int64(json_object* o, const char* key, bool* valid) {
+	json_value_t* value = json_object_get_object_as_value(o, key);
+	if (value == NULL) {
+		if (valid != NULL)
+			*valid = false;
+		return 0;
+	}
+	return json_as_int64(value, valid);
+}
+
+int64_t json_object_get_int64_default(json_object* o, const char* key, int64_t defval) {
+	bool valid = false;
+	int64_t result = json_object_get_int64(o, key, &valid);
+	if (!valid)
+		result = defval;
+	return result;
+}
+
 double json_object_get_double_default(json_object* o, const char* key, double defval) {
 	bool valid = false;
 	double result = json_object_get_double(o, key, &valid);
@@ -396,63 +904,76 @@ bool json_object_is_null(json_object* o, const char* key) {
 json_array* json_make_array(aojls_ctx_t* ctx) {
 	if (ctx == NULL)
 		return NULL;
-	json_array* o = (json_array*)calloc(1, sizeof(json_array));
-	if (o == NULL) {
-		ctx->failed = true;
+	json_array* o = (json_array*)make_value(ctx, sizeof(json_array), JS_ARRAY);
+	if (o == NULL)
 		return NULL;
-	}
 
-	o->self.type = JS_ARRAY;
+	o->ctx = ctx;
 	o->allocated = AOJLS_ARRAY_START_ALLOC_SIZE;
 	o->n = 0;
-	o->elements = (json_value_t**)malloc(o->allocated*sizeof(json_value_t*));
+	ctx->stats.container_slack += o->allocated;
+	o->elements = (_aojls_slot_t*)arena_alloc(&ctx->arena, o->allocated*sizeof(_aojls_slot_t));
 	if (o->elements == NULL) {
-		free(o);
 		ctx->failed = true;
 		return NULL;
 	}
 
-	append_to_context(ctx, &o->self);
 	return o;
 }
 
-json_array* json_array_add(json_array* a, json_value_t* value) {
-	if (a == NULL || value == NULL) {
-		if (a != NULL)
-			a->self.ctx->failed = true;
+static json_array* array_add(json_array* a, _aojls_slot_t* value) {
+	if (a->ctx->frozen) {
+		a->ctx->failed = true;
 		return NULL;
 	}
+	if (!array_loaded(a))
+		return NULL;
 
 	if (a->n == a->allocated) {
 		// reallocate and increase the size
-		size_t allocated = a->allocated * 2;
-		json_value_t** elements = (json_value_t**)realloc(a->elements, allocated*sizeof(json_value_t*));
+		size_t allocated = a->allocated == 0 ? AOJLS_ARRAY_START_ALLOC_SIZE : a->allocated * 2;
+		_aojls_slot_t* elements = (_aojls_slot_t*)arena_realloc(&a->ctx->arena, a->elements,
+				a->allocated*sizeof(_aojls_slot_t), allocated*sizeof(_aojls_slot_t));
 		if (elements == NULL) {
-			a->self.ctx->failed = true;
+			a->ctx->failed = true;
 			return NULL;
 		}
+		a->ctx->stats.container_slack += allocated - a->allocated;
 		a->allocated = allocated;
 		a->elements = elements;
 	}
 
-	a->elements[a->n] = value;
+	a->elements[a->n] = *value;
 	++a->n;
+	--a->ctx->stats.container_slack;
 
 	return a;
 }
 
+json_array* json_array_add(json_array* a, json_value_t* value) {
+	if (a == NULL || value == NULL) {
+		if (a != NULL)
+			a->ctx->failed = true;
+		return NULL;
+	}
+
+	_aojls_slot_t slot;
+	slot_store(&slot, value);
+	return array_add(a, &slot);
+}
+
 size_t json_array_size(json_array* a) {
-	if (a == NULL)
+	if (a == NULL || !array_loaded(a))
 		return 0;
 	return a->n;
 }
 
 json_value_t* json_array_get(json_array* a, size_t i) {
-	if (a == NULL)
+	if (a == NULL || !array_loaded(a))
 		return NULL;
 	if (i >= a->n)
 		return NULL;
-	return a->elements[i];
+	return slot_value(&a->elements[i]);
 }
 
 json_object* json_array_get_object(json_array* a, size_t key) {
@@ -481,6 +1002,24 @@ double json_array_get_double(json_array* a, size_t key, bool* valid) {
 	return json_as_number(value, valid);
 }
 
+int64_t json_array_get_int64(json_array* a, size_t key, bool* valid) {
+	json_value_t* value = json_array_get(a, key);
+	if (value == NULL) {
+		if (valid != NULL)
+			*valid = false;
+		return 0;
+	}
+	return json_as_int64(value, valid);
+}
+
+int64_t json_array_get_int64_default(json_array* a, size_t key, int64_t defval) {
+	bool valid = false;
+	int64_t result = json_array_get_int64(a, key, &valid);
+	if (!valid)
+		result = defval;
+	return result;
+}
+
 double json_array_get_double_default(json_array* a, size_t key, double defval) {
 	bool valid = false;
 	double result = json_array_get_double(a, key, &valid);
@@ -529,79 +1068,452 @@ bool json_array_is_null(json_array* a, size_t key) {
 
 // primitives
 
-json_string* json_from_string(aojls_ctx_t* ctx, char* string) {
-	if (ctx == NULL || string == NULL) {
-		if (ctx != NULL)
-			ctx->failed = true;
-		return NULL;
-	}
-	json_string* o = (json_string*)calloc(1, sizeof(json_string));
+static inline size_t string_size(size_t len) {
+	// short strings fit into the inline storage, longer ones are allocated right after the node
+	size_t storage = len + 1 < AOJLS_STRING_INLINE_SIZE ? AOJLS_STRING_INLINE_SIZE : len + 1;
+	return sizeof(json_string) + storage;
+}
+
+// string of len bytes with uninitialized data
+static json_string* alloc_string(aojls_ctx_t* ctx, size_t len) {
+	json_string* o = (json_string*)arena_alloc(&ctx->arena, string_size(len));
 	if (o == NULL) {
 		ctx->failed = true;
 		return NULL;
 	}
-	string = append_string(ctx, string, strlen(string));
-	if (string == NULL) {
-		free(o);
-		ctx->failed = true;
-		return NULL;
-	}
-
 	o->self.type = JS_STRING;
-	o->value = string;
-	append_to_context(ctx, &o->self);
+	o->borrowed = false;
+	o->escaped = false;
+	o->value = o->data;
+	o->len = len;
+	++ctx->stats.count[JS_STRING];
+	ctx->stats.string_bytes += len;
+	o->data[len] = '\0';
 	return o;
 }
 
-json_number* json_from_number(aojls_ctx_t* ctx, double number) {
-	if (ctx == NULL) {
-		return NULL;
-	}
-	json_number* o = (json_number*)calloc(1, sizeof(json_number));
+static json_string* make_string(aojls_ctx_t* ctx, const char* string, size_t len) {
+	json_string* o = alloc_string(ctx, len);
+	if (o != NULL)
+		memcpy(o->data, string, len);
+	return o;
+}
+
+static json_string* make_borrowed_string(aojls_ctx_t* ctx, const char* string, size_t len, bool escaped) {
+	json_string* o = (json_string*)arena_alloc(&ctx->arena, sizeof(json_string) + sizeof(aojls_ctx_t*));
 	if (o == NULL) {
 		ctx->failed = true;
 		return NULL;
 	}
-	o->self.type = JS_NUMBER;
-	o->value = number;
-
-	append_to_context(ctx, &o->self);
+	o->self.type = JS_STRING;
+	o->borrowed = true;
+	o->escaped = escaped;
+	o->value = (char*)string;
+	o->len = len;
+	// context is needed to copy the string later
+	memcpy(o->data, &ctx, sizeof(aojls_ctx_t*));
+	++ctx->stats.count[JS_STRING];
 	return o;
 }
 
-json_boolean* json_from_boolean(aojls_ctx_t* ctx, bool b) {
-	if (ctx == NULL)
-		return NULL;
-	json_boolean* o = (json_boolean*)calloc(1, sizeof(json_boolean));
+static json_string* make_insitu_string(aojls_ctx_t* ctx, char* string, size_t len) {
+	json_string* o = (json_string*)arena_alloc(&ctx->arena, sizeof(json_string));
 	if (o == NULL) {
 		ctx->failed = true;
 		return NULL;
 	}
-	o->self.type = JS_BOOL;
-	o->value = b;
+	o->self.type = JS_STRING;
+	o->borrowed = false;
+	o->escaped = false;
+	o->value = string;
+	o->len = len;
+	++ctx->stats.count[JS_STRING];
+	return o;
+}
+
+// decodes escape sequences the same way the lexer does, returns decoded length, dst may be src
+static size_t unescape(char* dst, const char* src, size_t len) {
+	size_t n = 0;
+	for (size_t i=0; i<len; i++) {
+		char c = src[i];
+		if (c == '\\' && i+1 < len) {
+			c = src[++i];
+			switch (c) {
+			case 'b': c = '\b'; break;
+			case 'f': c = '\f'; break;
+			case 'n': c = '\n'; break;
+			case 'r': c = '\r'; break;
+			case 't': c = '\t'; break;
+			case 'u': dst[n++] = '\\'; break;
+			default: break; // ", / and \ stand for themselves
+			}
+		}
+		dst[n++] = c;
+	}
+	return n;
+}
+
+// length that unescape decodes len bytes of src to
+static size_t unescaped_length(const char* src, size_t len) {
+	size_t n = len;
+	for (size_t i=0; i+1<len; i++) {
+		if (src[i] == '\\') {
+			if (src[i+1] != 'u')
+				--n;
+			++i;
+		}
+	}
+	return n;
+}
+
+// copies borrowed string into its context, decoding it if needed
+static bool string_own(json_string* s) {
+	if (!s->borrowed)
+		return true;
+
+	aojls_ctx_t* ctx;
+	memcpy(&ctx, s->data, sizeof(aojls_ctx_t*));
+	char* value = (char*)arena_alloc(&ctx->arena, s->len + 1);
+	if (value == NULL) {
+		ctx->failed = true;
+		return false;
+	}
+	size_t len = s->len;
+	if (s->escaped)
+		len = unescape(value, s->value, s->len);
+	else
+		memcpy(value, s->value, len);
+	value[len] = '\0';
+
+	s->value = value;
+	s->len = len;
+	s->borrowed = false;
+	s->escaped = false;
+	ctx->stats.string_bytes += len;
+	return true;
+}
+
+json_string* json_from_string(aojls_ctx_t* ctx, char* string) {
+	if (ctx == NULL || string == NULL) {
+		if (ctx != NULL)
+			ctx->failed = true;
+		return NULL;
+	}
+	return make_string(ctx, string, strlen(string));
+}
+
+json_number* json_from_number(aojls_ctx_t* ctx, double number) {
+	if (ctx == NULL) {
+		return NULL;
+	}
+	json_number* o = (json_number*)make_value(ctx, sizeof(json_number), JS_NUMBER);
+	if (o == NULL)
+		return NULL;
+	o->as.number = number;
+	return o;
+}
 
-	append_to_context(ctx, &o->self);
+json_number* json_from_int64(aojls_ctx_t* ctx, int64_t number) {
+	if (ctx == NULL) {
+		return NULL;
+	}
+	json_number* o = (json_number*)make_value(ctx, sizeof(json_number), JS_NUMBER);
+	if (o == NULL)
+		return NULL;
+	o->kind = NUM_INT64;
+	o->as.int64 = number;
 	return o;
 }
 
+json_boolean* json_from_boolean(aojls_ctx_t* ctx, bool b) {
+	if (ctx == NULL)
+		return NULL;
+	++ctx->stats.count[JS_BOOL];
+	return b ? &ctx->true_value : &ctx->false_value;
+}
+
 json_null* json_make_null(aojls_ctx_t* ctx) {
 	if (ctx == NULL)
 		return NULL;
-	json_null* o = (json_null*)calloc(1, sizeof(json_null));
-	if (o == NULL) {
-		ctx->failed = true;
+	++ctx->stats.count[JS_NULL];
+	return &ctx->null_value;
+}
+
+// deep copy
+
+static inline size_t measure_raw(_aojls_slot_t* slot) {
+	if (slot->self.type == JS_NUMBER && slot->kind == NUM_RAW)
+		return ARENA_ROUND(strlen(slot->as.raw) + 1);
+	return 0;
+}
+
+static inline bool copy_raw(aojls_ctx_t* ctx, _aojls_slot_t* slot) {
+	// number text belongs to the source context
+	if (slot->self.type == JS_NUMBER && slot->kind == NUM_RAW) {
+		slot->as.raw = append_string(ctx, slot->as.raw, strlen(slot->as.raw));
+		return slot->as.raw != NULL;
+	}
+	return true;
+}
+
+static size_t measure_value(json_value_t* value) {
+	// arena bytes needed by copy_value, upper bound
+	switch (value->type) {
+	case JS_OBJECT: {
+		json_object* o = (json_object*)value;
+		if (!object_loaded(o))
+			return 0;
+		size_t size = ARENA_ROUND(sizeof(json_object)) + ARENA_ROUND(o->n*sizeof(_aojls_member_t));
+		for (size_t i=0; i<o->n; i++) {
+			_aojls_member_t* m = &o->members[i];
+			size += ARENA_ROUND(strlen(m->key) + 1);
+			if (!is_inline_type(m->value.self.type))
+				size += measure_value(m->value.as.ref);
+			else
+				size += measure_raw(&m->value);
+		}
+		return size;
+	}
+	case JS_ARRAY: {
+		json_array* a = (json_array*)value;
+		if (!array_loaded(a))
+			return 0;
+		size_t size = ARENA_ROUND(sizeof(json_array)) + ARENA_ROUND(a->n*sizeof(_aojls_slot_t));
+		for (size_t i=0; i<a->n; i++) {
+			if (!is_inline_type(a->elements[i].self.type))
+				size += measure_value(a->elements[i].as.ref);
+			else
+				size += measure_raw(&a->elements[i]);
+		}
+		return size;
+	}
+	case JS_STRING: {
+		json_string* s = (json_string*)value;
+		return ARENA_ROUND(string_size(s->escaped ? unescaped_length(s->value, s->len) : s->len));
+	}
+	default:
+		return ARENA_ROUND(sizeof(_aojls_slot_t)) + measure_raw((_aojls_slot_t*)value);
+	}
+}
+
+static bool copy_slot(aojls_ctx_t* ctx, _aojls_slot_t* dst, _aojls_slot_t* src);
+
+static json_value_t* copy_value(aojls_ctx_t* ctx, json_value_t* value) {
+	// depth first, every container is followed by its exactly sized storage and then its children
+	switch (value->type) {
+	case JS_OBJECT: {
+		json_object* src = (json_object*)value;
+		if (!object_loaded(src))
+			return NULL;
+		json_object* o = (json_object*)make_value(ctx, sizeof(json_object), JS_OBJECT);
+		if (o == NULL)
+			return NULL;
+		o->ctx = ctx;
+		if (src->n > 0) {
+			o->members = (_aojls_member_t*)arena_alloc(&ctx->arena, src->n*sizeof(_aojls_member_t));
+			if (o->members == NULL) {
+				ctx->failed = true;
+				return NULL;
+			}
+		}
+		o->allocated = src->n;
+		for (size_t i=0; i<src->n; i++) {
+			_aojls_member_t* m = &src->members[i];
+			o->members[i].key = store_key(ctx, m->key, strlen(m->key));
+			if (o->members[i].key == NULL || !copy_slot(ctx, &o->members[i].value, &m->value))
+				return NULL;
+			++o->n;
+		}
+		return &o->self;
+	}
+	case JS_ARRAY: {
+		json_array* src = (json_array*)value;
+		if (!array_loaded(src))
+			return NULL;
+		json_array* a = (json_array*)make_value(ctx, sizeof(json_array), JS_ARRAY);
+		if (a == NULL)
+			return NULL;
+		a->ctx = ctx;
+		if (src->n > 0) {
+			a->elements = (_aojls_slot_t*)arena_alloc(&ctx->arena, src->n*sizeof(_aojls_slot_t));
+			if (a->elements == NULL) {
+				ctx->failed = true;
+				return NULL;
+			}
+		}
+		a->allocated = src->n;
+		for (size_t i=0; i<src->n; i++) {
+			if (!copy_slot(ctx, &a->elements[i], &src->elements[i]))
+				return NULL;
+			++a->n;
+		}
+		return &a->self;
+	}
+	case JS_STRING: {
+		json_string* src = (json_string*)value;
+		if (!src->escaped)
+			return (json_value_t*)make_string(ctx, src->value, src->len);
+		// borrowed string is decoded straight into the copy, src is left as it is
+		json_string* s = alloc_string(ctx, unescaped_length(src->value, src->len));
+		if (s != NULL)
+			unescape(s->data, src->value, src->len);
+		return (json_value_t*)s;
+	}
+	default: {
+		_aojls_slot_t slot = *(_aojls_slot_t*)value;
+		++ctx->stats.count[slot.self.type];
+		if (!copy_raw(ctx, &slot))
+			return NULL;
+		return slot_detach(ctx, &slot);
+	}
+	}
+}
+
+static bool copy_slot(aojls_ctx_t* ctx, _aojls_slot_t* dst, _aojls_slot_t* src) {
+	if (is_inline_type(src->self.type)) {
+		*dst = *src;
+		++ctx->stats.count[src->self.type];
+		return copy_raw(ctx, dst);
+	}
+	json_value_t* value = copy_value(ctx, src->as.ref);
+	if (value == NULL)
+		return false;
+	slot_store(dst, value);
+	return true;
+}
+
+json_value_t* json_value_clone(aojls_ctx_t* ctx, json_value_t* value) {
+	if (ctx == NULL || value == NULL) {
+		if (ctx != NULL)
+			ctx->failed = true;
 		return NULL;
 	}
-	o->self.type = JS_NULL;
 
-	append_to_context(ctx, &o->self);
-	return o;
+	// whole copy goes into one contiguous block with exact container capacities
+	if (!arena_reserve(&ctx->arena, measure_value(value))) {
+		ctx->failed = true;
+		return NULL;
+	}
+	return copy_value(ctx, value);
 }
 
 // context
 
 aojls_ctx_t* json_make_context() {
-	return (aojls_ctx_t*) calloc(1, sizeof(aojls_ctx_t));
+	return json_make_context_with_allocator(NULL);
+}
+
+aojls_ctx_t* json_make_context_with_allocator(const aojls_allocator_t* allocator) {
+	if (allocator == NULL)
+		allocator = &default_allocator;
+	aojls_ctx_t* ctx = (aojls_ctx_t*)mem_calloc(allocator, sizeof(aojls_ctx_t));
+	if (ctx == NULL)
+		return NULL;
+	ctx->allocator = *allocator;
+	ctx->arena.allocator = &ctx->allocator;
+	ctx->scratch.allocator = &ctx->allocator;
+
+	ctx->true_value.self.type = JS_BOOL;
+	ctx->true_value.as.boolean = true;
+	ctx->false_value.self.type = JS_BOOL;
+	ctx->false_value.as.boolean = false;
+	ctx->null_value.self.type = JS_NULL;
+	return ctx;
+}
+
+void json_context_reset(aojls_ctx_t* ctx) {
+	if (ctx == NULL)
+		return;
+
+	arena_reset(&ctx->arena);
+	arena_reset(&ctx->scratch);
+	ctx->result = NULL;
+	ctx->failed = false;
+	ctx->frozen = false;
+	memset(&ctx->stats, 0, sizeof(aojls_ctx_stats_t));
+	ctx->uninterned = 0;
+	ctx->itable = NULL;
+	ctx->icapacity = 0;
+	ctx->icount = 0;
+}
+
+bool json_context_stats(aojls_ctx_t* ctx, aojls_ctx_stats_t* stats) {
+	if (ctx == NULL || stats == NULL)
+		return false;
+
+	*stats = ctx->stats;
+	stats->used_bytes = 0;
+	stats->total_bytes = sizeof(aojls_ctx_t);
+	arena_stats(&ctx->arena, &stats->used_bytes, &stats->total_bytes);
+	size_t scratch_used = 0;
+	arena_stats(&ctx->scratch, &scratch_used, &stats->total_bytes);
+	return true;
+}
+
+bool json_context_freeze(aojls_ctx_t* ctx) {
+	if (ctx == NULL || ctx->result == NULL)
+		return false;
+	if (ctx->frozen)
+		return true;
+
+	size_t size = measure_value(ctx->result);
+	size_t tsize = 0;
+	if (ctx->intern_keys)
+		tsize = ARENA_ROUND(ctx->icapacity*sizeof(_aojls_intern_entry_t));
+
+	// copy result into new arena, then drop the old one
+	_aojls_arena_t old = ctx->arena;
+	_aojls_intern_entry_t* itable = ctx->itable;
+	size_t icapacity = ctx->icapacity;
+	size_t icount = ctx->icount;
+	size_t uninterned = ctx->uninterned;
+	aojls_ctx_stats_t stats = ctx->stats;
+
+	ctx->arena.first = NULL;
+	ctx->arena.current = NULL;
+	ctx->arena.chunk_size = 0; // frozen document gets a block of its exact size, not the next doubled chunk
+	if (!arena_reserve(&ctx->arena, tsize + size)) {
+		ctx->arena = old;
+		ctx->failed = true;
+		return false;
+	}
+	ctx->itable = NULL;
+	ctx->icapacity = 0;
+	ctx->icount = 0;
+	ctx->uninterned = 0;
+	if (tsize > 0) {
+		// same capacity as before, so that the table does not grow while copying
+		ctx->itable = (_aojls_intern_entry_t*)arena_alloc(&ctx->arena, tsize);
+		memset(ctx->itable, 0, tsize);
+		ctx->icapacity = icapacity;
+	}
+	memset(&ctx->stats, 0, sizeof(aojls_ctx_stats_t));
+
+	json_value_t* result = copy_value(ctx, ctx->result);
+	if (result == NULL) {
+		arena_release(&ctx->arena);
+		ctx->arena = old;
+		ctx->itable = itable;
+		ctx->icapacity = icapacity;
+		ctx->icount = icount;
+		ctx->uninterned = uninterned;
+		ctx->stats = stats;
+		ctx->failed = true;
+		return false;
+	}
+
+	arena_release(&old);
+	// frozen context does not parse anymore, temporary buffers are allocated again after reset
+	arena_release(&ctx->scratch);
+	ctx->result = result;
+	ctx->frozen = true;
+	return true;
+}
+
+void json_context_set_key_interning(aojls_ctx_t* ctx, bool intern) {
+	if (ctx == NULL)
+		return;
+	ctx->intern_keys = intern;
 }
 
 bool json_context_error_happened(aojls_ctx_t* ctx) {
@@ -618,35 +1530,9 @@ void json_free_context(aojls_ctx_t* ctx) {
 	if (ctx == NULL)
 		return;
 
-	_aojls_alloc_node_t* anode = ctx->snode;
-	while (anode != NULL) {
-		_aojls_alloc_node_t* node = anode;
-		anode = node->next;
-
-		json_value_t* v = (json_value_t*)node;
-		if (v->type == JS_OBJECT || v->type == JS_ARRAY) {
-			if (v->type == JS_OBJECT) {
-				json_object* o = json_as_object(v);
-				free(o->keys);
-				free(o->values);
-			} else {
-				json_array* a = json_as_array(v);
-				free(a->elements);
-			}
-		}
-
-		free(node);
-	}
-
-	char_node_t* cnode = ctx->ssnode;
-	while (cnode != NULL) {
-		char_node_t* node = cnode;
-		cnode = node->next;
-		free(node->data);
-		free(node);
-	}
-
-	free(ctx);
+	arena_release(&ctx->arena);
+	arena_release(&ctx->scratch);
+	mem_free(&ctx->allocator, ctx);
 }
 
 // serialization
@@ -655,6 +1541,8 @@ typedef struct {
 	char* data;
 	size_t offset;
 	size_t len;
+	const aojls_allocator_t* allocator;
+	_aojls_arena_t* arena; // if set, buffer is grown in this arena instead
 } string_buffer_data_t;
 
 static bool string_writer_function(const char* buffer, size_t len, void* writer_data) {
@@ -664,7 +1552,11 @@ static bool string_writer_function(const char* buffer, size_t len, void* writer_
 		size_t addendum = wd->len*2;
 		if (addendum == 0)
 			addendum = 2048;
-		char* rb = (char*)realloc(wd->data, addendum);
+		char* rb;
+		if (wd->arena != NULL)
+			rb = (char*)arena_realloc(wd->arena, wd->data, wd->len, addendum);
+		else
+			rb = (char*)mem_realloc(wd->allocator, wd->data, addendum);
 		if (rb == NULL) {
 			return false;
 		}
@@ -679,8 +1571,7 @@ static bool string_writer_function(const char* buffer, size_t len, void* writer_
 	return true;
 }
 
-static bool do_serialize_string(char* string, aojls_serialization_prefs* prefs) {
-	size_t len = strlen(string);
+static bool do_serialize_string(const char* string, size_t len, aojls_serialization_prefs* prefs) {
 	if (!prefs->writer("\"", 1, prefs->writer_data))
 		return false;
 	for (size_t i=0; i<len; i++) {
@@ -718,6 +1609,45 @@ static bool do_serialize_string(char* string, aojls_serialization_prefs* prefs)
 	return true;
 }
 
+static const char digit_pairs[201] =
+	"00010203040506070809"
+	"10111213141516171819"
+	"20212223242526272829"
+	"30313233343536373839"
+	"40414243444546474849"
+	"50515253545556575859"
+	"60616263646566676869"
+	"70717273747576777879"
+	"80818283848586878889"
+	"90919293949596979899";
+
+static size_t format_uint64(char* buf, uint64_t v) {
+	// digits are produced two at a time from the end
+	char tmp[20];
+	size_t i = sizeof(tmp);
+	while (v >= 100) {
+		size_t d = (size_t)(v % 100) * 2;
+		v /= 100;
+		tmp[--i] = digit_pairs[d + 1];
+		tmp[--i] = digit_pairs[d];
+	}
+	if (v >= 10) {
+		tmp[--i] = digit_pairs[v*2 + 1];
+		tmp[--i] = digit_pairs[v*2];
+	} else
+		tmp[--i] = (char)('0' + v);
+	memcpy(buf, tmp + i, sizeof(tmp) - i);
+	return sizeof(tmp) - i;
+}
+
+static size_t format_int64(char* buf, int64_t v) {
+	if (v < 0) {
+		buf[0] = '-';
+		return 1 + format_uint64(buf + 1, -(uint64_t)v);
+	}
+	return format_uint64(buf, (uint64_t)v);
+}
+
 static bool do_serialize(json_value_t* value, aojls_serialization_prefs* prefs,
 		const char* perlinsert, const char* eol, size_t level) {
 	if (value == NULL)
@@ -741,7 +1671,7 @@ static bool do_serialize(json_value_t* value, aojls_serialization_prefs* prefs,
 			}
 
 			char* key = json_object_get_key(o, k);
-			if (!do_serialize_string(key, prefs))
+			if (!do_serialize_string(key, strlen(key), prefs))
 				return false;
 			if (prefs->pretty) {
 				if (!prefs->writer(" : ", 3, prefs->writer_data))
@@ -751,7 +1681,7 @@ static bool do_serialize(json_value_t* value, aojls_serialization_prefs* prefs,
 					return false;
 			}
 
-			json_value_t* value = json_object_get_object_as_value(o, key);
+			json_value_t* value = slot_value(&o->members[k].value);
 			if (!do_serialize(value, prefs, perlinsert, eol, nl))
 				return false;
 
@@ -820,14 +1750,23 @@ static bool do_serialize(json_value_t* value, aojls_serialization_prefs* prefs,
 		return true;
 	}
 	case JS_NUMBER: {
-		double num = json_as_number(value, NULL);
+		json_number* number = (json_number*)value;
 		char buf[MAX_DOUBLE_LENGTH];
-		sprintf(buf, prefs->number_formatter, num);
+		if (number->kind == NUM_RAW)
+			return prefs->writer(number->as.raw, strlen(number->as.raw), prefs->writer_data);
+		if (number->kind != NUM_DOUBLE) {
+			size_t len = number->kind == NUM_INT64 ? format_int64(buf, number->as.int64)
+					: format_uint64(buf, number->as.uint64);
+			return prefs->writer(buf, len, prefs->writer_data);
+		}
+		sprintf(buf, prefs->number_formatter, number->as.number);
 		return prefs->writer(buf, strlen(buf), prefs->writer_data);
 	}
 	case JS_STRING: {
-		char* string = json_as_string(value);
-		return do_serialize_string(string, prefs);
+		json_string* string = (json_string*)value;
+		if (string->escaped && !string_own(string))
+			return false;
+		return do_serialize_string(string->value, string->len, prefs);
 	}
 	case JS_BOOL: {
 		bool v = json_as_bool(value, NULL);
@@ -856,7 +1795,7 @@ static bool serialize(json_value_t* value, aojls_serialization_prefs* prefs) {
 			eol = "\n";
 		else
 			eol = prefs->eol;
-		perlinsert = (char*)malloc((prefs->offset_per_level)+1 * sizeof(char));
+		perlinsert = (char*)mem_malloc(prefs->allocator, (prefs->offset_per_level+1) * sizeof(char));
 		if (perlinsert == NULL) {
 			return false;
 		}
@@ -869,7 +1808,7 @@ static bool serialize(json_value_t* value, aojls_serialization_prefs* prefs) {
 	r = do_serialize(value, prefs, perlinsert, eol, 0);
 
 	if (prefs->pretty) {
-		free(perlinsert);
+		mem_free(prefs->allocator, perlinsert);
 	}
 	return r;
 }
@@ -877,31 +1816,35 @@ static bool serialize(json_value_t* value, aojls_serialization_prefs* prefs) {
 char* aojls_serialize(json_value_t* value, aojls_serialization_prefs* prefs) {
 	aojls_serialization_prefs p;
 	if (prefs == NULL) {
-		p.pretty = false;
-		p.writer_data = NULL;
-		p.writer = NULL;
+		memset(&p, 0, sizeof(aojls_serialization_prefs));
 	} else {
 		p = *prefs;
 	}
+	// allocator is only read when asked for, callers filling prefs field by field never set it
+	const aojls_allocator_t* allocator = p.allocator;
+	if (!p.use_allocator || p.allocator == NULL)
+		p.allocator = &default_allocator;
 
 	bool selfbuffer = false;
 	if (p.writer == NULL) {
 		selfbuffer = true;
 		p.writer = string_writer_function;
-		string_buffer_data_t* wd = (string_buffer_data_t*)malloc(sizeof(string_buffer_data_t));
+		string_buffer_data_t* wd = (string_buffer_data_t*)mem_malloc(p.allocator, sizeof(string_buffer_data_t));
 		if (wd == NULL) {
 			p.success = false;
 			return NULL;
 		}
 
-		wd->data = (char*)malloc(2048);
+		wd->data = (char*)mem_malloc(p.allocator, 2048);
 		if (wd->data == NULL) {
-			free(wd);
+			mem_free(p.allocator, wd);
 			p.success = false;
 			return NULL;
 		}
 		wd->len = 2048;
 		wd->offset = 0;
+		wd->allocator = p.allocator;
+		wd->arena = NULL;
 		p.writer_data = wd;
 	}
 
@@ -909,8 +1852,9 @@ char* aojls_serialize(json_value_t* value, aojls_serialization_prefs* prefs) {
 	p.success = result;
 
 	if ((!result && selfbuffer) || (!p.writer("\0", 1, p.writer_data) && selfbuffer)) {
-		free(((string_buffer_data_t*)p.writer_data)->data);
-		free(p.writer_data);
+		mem_free(p.allocator, ((string_buffer_data_t*)p.writer_data)->data);
+		mem_free(p.allocator, p.writer_data);
+		p.allocator = allocator;
 		if (prefs != NULL) {
 			*prefs = p;
 		}
@@ -919,13 +1863,15 @@ char* aojls_serialize(json_value_t* value, aojls_serialization_prefs* prefs) {
 
 	if (selfbuffer) {
 		char* buffer = ((string_buffer_data_t*)p.writer_data)->data;
-		free(p.writer_data);
+		mem_free(p.allocator, p.writer_data);
+		p.allocator = allocator;
 		if (prefs != NULL) {
 			*prefs = p;
 		}
 		return buffer;
 	}
 
+	p.allocator = allocator;
 	if (prefs != NULL) {
 		*prefs = p;
 	}
@@ -934,7 +1880,7 @@ char* aojls_serialize(json_value_t* value, aojls_serialization_prefs* prefs) {
 
 // Deserializer
 
-long string_reader_function(char* buffer, size_t len, void* reader_data) {
+long string_reader_function(const char** chunk, void* reader_data) {
 	string_buffer_data_t* rd = (string_buffer_data_t*)reader_data;
 	if (rd == NULL || rd->data == NULL) {
 		return -1;
@@ -942,966 +1888,1890 @@ long string_reader_function(char* buffer, size_t len, void* reader_data) {
 		return 0;
 	}
 
-	size_t readsiz = len >= rd->len - rd->offset ?
-			rd->len - rd->offset : len;
-	memcpy(buffer, rd->data+rd->offset, readsiz);
-	rd->offset += readsiz;
+	// whole rest of the source is lent at once
+	*chunk = rd->data+rd->offset;
+	size_t readsiz = rd->len - rd->offset;
+	rd->offset = rd->len;
 	return readsiz;
 }
 
+typedef struct {
+	aojls_deserialization_prefs* prefs;
+	const char* data;
+	size_t len;
+	size_t pos;
+	char* buffer;
+	size_t buffer_size;
+} input_t;
+
+static long input_fill(input_t* in) {
+	aojls_deserialization_prefs* prefs = in->prefs;
+	long readc;
+
+	if (prefs->chunk_reader != NULL) {
+		const char* chunk = NULL;
+		readc = prefs->chunk_reader(&chunk, prefs->reader_data);
+		if (readc > 0 && chunk == NULL) {
+			readc = -1;
+		}
+		in->data = chunk;
+	} else {
+		readc = prefs->reader(in->buffer, in->buffer_size, prefs->reader_data);
+		if (readc > (long)in->buffer_size) {
+			readc = -1;
+		}
+		in->data = in->buffer;
+	}
+
+	in->pos = 0;
+	in->len = readc > 0 ? readc : 0;
+	return readc;
+}
+
+/* input scanning */
+
+// returns first char in [p, end) that ends plain string run: ", \ or control char
+static const char* scan_string_scalar(const char* p, const char* end) {
+	while (p < end && *p != '"' && *p != '\\' && (unsigned char)*p >= 0x20)
+		++p;
+	return p;
+}
+
+// returns first non whitespace char in [p, end)
+static const char* skip_whitespace_scalar(const char* p, const char* end) {
+	while (p < end && (*p == 0x20 || *p == 0x09 || *p == 0x0A || *p == 0x0D))
+		++p;
+	return p;
+}
+
+#if defined(AOJLS_SIMD_X86)
+
+static const char* scan_string_sse2(const char* p, const char* end) {
+	const __m128i quote = _mm_set1_epi8('"');
+	const __m128i backslash = _mm_set1_epi8('\\');
+	const __m128i control = _mm_set1_epi8(0x1F);
+	while (end - p >= 16) {
+		__m128i v = _mm_loadu_si128((const __m128i*)p);
+		__m128i m = _mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash));
+		m = _mm_or_si128(m, _mm_cmpeq_epi8(_mm_min_epu8(v, control), v));
+		int mask = _mm_movemask_epi8(m);
+		if (mask != 0)
+			return p + __builtin_ctz(mask);
+		p += 16;
+	}
+	return scan_string_scalar(p, end);
+}
+
+static const char* skip_whitespace_sse2(const char* p, const char* end) {
+	while (end - p >= 16) {
+		__m128i v = _mm_loadu_si128((const __m128i*)p);
+		__m128i m = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(0x20)), _mm_cmpeq_epi8(v, _mm_set1_epi8(0x09)));
+		m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8(0x0A)));
+		m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8(0x0D)));
+		int mask = ~_mm_movemask_epi8(m) & 0xFFFF;
+		if (mask != 0)
+			return p + __builtin_ctz(mask);
+		p += 16;
+	}
+	return skip_whitespace_scalar(p, end);
+}
+
+__attribute__((target("avx2")))
+static const char* scan_string_avx2(const char* p, const char* end) {
+	const __m256i quote = _mm256_set1_epi8('"');
+	const __m256i backslash = _mm256_set1_epi8('\\');
+	const __m256i control = _mm256_set1_epi8(0x1F);
+	while (end - p >= 32) {
+		__m256i v = _mm256_loadu_si256((const __m256i*)p);
+		__m256i m = _mm256_or_si256(_mm256_cmpeq_epi8(v, quote), _mm256_cmpeq_epi8(v, backslash));
+		m = _mm256_or_si256(m, _mm256_cmpeq_epi8(_mm256_min_epu8(v, control), v));
+		unsigned int mask = (unsigned int)_mm256_movemask_epi8(m);
+		if (mask != 0)
+			return p + __builtin_ctz(mask);
+		p += 32;
+	}
+	return scan_string_sse2(p, end);
+}
+
+__attribute__((target("avx2")))
+static const char* skip_whitespace_avx2(const char* p, const char* end) {
+	while (end - p >= 32) {
+		__m256i v = _mm256_loadu_si256((const __m256i*)p);
+		__m256i m = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(0x20)), _mm256_cmpeq_epi8(v, _mm256_set1_epi8(0x09)));
+		m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8(0x0A)));
+		m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8(0x0D)));
+		unsigned int mask = ~(unsigned int)_mm256_movemask_epi8(m);
+		if (mask != 0)
+			return p + __builtin_ctz(mask);
+		p += 32;
+	}
+	return skip_whitespace_sse2(p, end);
+}
+
+#elif defined(AOJLS_SIMD_NEON)
+
+static const char* scan_string_neon(const char* p, const char* end) {
+	const uint8x16_t quote = vdupq_n_u8('"');
+	const uint8x16_t backslash = vdupq_n_u8('\\');
+	const uint8x16_t control = vdupq_n_u8(0x20);
+	while (end - p >= 16) {
+		uint8x16_t v = vld1q_u8((const uint8_t*)p);
+		uint8x16_t m = vorrq_u8(vceqq_u8(v, quote), vceqq_u8(v, backslash));
+		m = vorrq_u8(m, vcltq_u8(v, control));
+		if (vmaxvq_u8(m) != 0)
+			return scan_string_scalar(p, p + 16);
+		p += 16;
+	}
+	return scan_string_scalar(p, end);
+}
+
+static const char* skip_whitespace_neon(const char* p, const char* end) {
+	while (end - p >= 16) {
+		uint8x16_t v = vld1q_u8((const uint8_t*)p);
+		uint8x16_t m = vorrq_u8(vceqq_u8(v, vdupq_n_u8(0x20)), vceqq_u8(v, vdupq_n_u8(0x09)));
+		m = vorrq_u8(m, vceqq_u8(v, vdupq_n_u8(0x0A)));
+		m = vorrq_u8(m, vceqq_u8(v, vdupq_n_u8(0x0D)));
+		if (vminvq_u8(m) == 0)
+			return skip_whitespace_scalar(p, p + 16);
+		p += 16;
+	}
+	return skip_whitespace_scalar(p, end);
+}
+
+#endif
+
+typedef const char*(*scan_function_t)(const char* p, const char* end);
+
+// picked per tokenizer, so there is no global state to initialize
+static void select_scanners(scan_function_t* scan_string, scan_function_t* skip_whitespace) {
+#if defined(AOJLS_SIMD_X86)
+	if (__builtin_cpu_supports("avx2")) {
+		*skip_whitespace = skip_whitespace_avx2;
+		*scan_string = scan_string_avx2;
+	} else {
+		*skip_whitespace = skip_whitespace_sse2;
+		*scan_string = scan_string_sse2;
+	}
+#elif defined(AOJLS_SIMD_NEON)
+	*skip_whitespace = skip_whitespace_neon;
+	*scan_string = scan_string_neon;
+#else
+	*skip_whitespace = skip_whitespace_scalar;
+	*scan_string = scan_string_scalar;
+#endif
+}
+
+static inline long input_next(input_t* in, char* c) {
+	if (in->pos == in->len) {
+		long readc = input_fill(in);
+		if (readc <= 0) {
+			return readc;
+		}
+	}
+	*c = in->data[in->pos++];
+	return 1;
+}
+
 typedef enum {
 	LEFT_CURLY, RIGHT_CURLY,
 	LEFT_SQUARE, RIGHT_SQUARE,
-	STRING, COMMA, COLON, DOT,
-	PLUS, MINUS, DIGIT, E,
+	STRING, COMMA, COLON, NUMBER,
 	_TRUE, _FALSE, _NULL
 } json_token_type_t;
 
+#define NUMBER_MINUS 1
+#define NUMBER_FRACTION 2
+#define NUMBER_EXPONENT 4
+
+#define STRING_BORROWED 1
+#define STRING_ESCAPED 2
+#define STRING_INSITU 4 // decoded and null terminated in the source
+
 typedef struct {
 	char* value;
 	size_t len;
 	json_token_type_t type;
+	int flags; // NUMBER_* flags of number tokens, STRING_* flags of string tokens
 } json_token_t;
 
-bool append_token(json_token_t** tbuf, size_t* bflen, size_t* n,
-		char* data, size_t len, json_token_type_t type) {
-	size_t bfl = *bflen;
-	size_t nn = *n;
+// character classes of the first char of a token
+enum {
+	CC_INVALID, CC_SPACE,
+	CC_LEFT_CURLY, CC_RIGHT_CURLY,
+	CC_LEFT_SQUARE, CC_RIGHT_SQUARE,
+	CC_COLON, CC_COMMA, CC_QUOTE, CC_NUMBER,
+	CC_TRUE, CC_FALSE, CC_NULL
+};
+
+static const unsigned char char_class[256] = {
+	[0x20] = CC_SPACE, [0x09] = CC_SPACE, [0x0A] = CC_SPACE, [0x0D] = CC_SPACE,
+	['{'] = CC_LEFT_CURLY, ['}'] = CC_RIGHT_CURLY,
+	['['] = CC_LEFT_SQUARE, [']'] = CC_RIGHT_SQUARE,
+	[':'] = CC_COLON, [','] = CC_COMMA, ['"'] = CC_QUOTE,
+	['-'] = CC_NUMBER, ['0'] = CC_NUMBER, ['1'] = CC_NUMBER, ['2'] = CC_NUMBER, ['3'] = CC_NUMBER,
+	['4'] = CC_NUMBER, ['5'] = CC_NUMBER, ['6'] = CC_NUMBER, ['7'] = CC_NUMBER, ['8'] = CC_NUMBER,
+	['9'] = CC_NUMBER,
+	['t'] = CC_TRUE, ['f'] = CC_FALSE, ['n'] = CC_NULL
+};
 
-	if (bfl == nn) {
-		size_t nl = bfl * 2;
-		json_token_t* nt = (json_token_t*)realloc(*tbuf, sizeof(json_token_t)*nl);
-		if (nt == NULL) {
-			return false;
-		}
-		*tbuf = nt;
-		*bflen = nl;
+static inline bool is_digit(char c) {
+	return c >= '0' && c <= '9';
+}
+
+static inline bool is_number_char(char c) {
+	return is_digit(c) || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+}
+
+// validates number span against JSON grammar, returns its NUMBER_* flags or -1
+static int number_flags(const char* s, size_t len) {
+	size_t i = 0;
+	size_t start;
+	int flags = 0;
+
+	if (i < len && s[i] == '-') {
+		flags |= NUMBER_MINUS;
+		++i;
+	}
+	if (i == len || !is_digit(s[i]))
+		return -1;
+	if (s[i] == '0') {
+		++i;
+	} else {
+		while (i < len && is_digit(s[i]))
+			++i;
 	}
 
-	json_token_t* t = *tbuf;
-	json_token_t* token = &t[*n];
-	*n += 1;
+	if (i < len && s[i] == '.') {
+		flags |= NUMBER_FRACTION;
+		start = ++i;
+		while (i < len && is_digit(s[i]))
+			++i;
+		if (i == start)
+			return -1;
+	}
+
+	if (i < len && (s[i] == 'e' || s[i] == 'E')) {
+		flags |= NUMBER_EXPONENT;
+		++i;
+		if (i < len && (s[i] == '+' || s[i] == '-'))
+			++i;
+		start = i;
+		while (i < len && is_digit(s[i]))
+			++i;
+		if (i == start)
+			return -1;
+	}
+
+	return i == len ? flags : -1;
+}
+
+#define PARTIAL_STRING 1
+#define PARTIAL_NUMBER 2
+
+#define NO_MARK SIZE_MAX
+
+typedef struct tokenizer {
+	// tokens are lexed on demand, parser only looks one token ahead
+	json_token_t token;
+	string_buffer_data_t text; // text of the token, reused by the next one
+	bool has_token;
+	bool eof;
+	int status; // FAIL_TOKENSTREAM if lexer failed
+	bool starved; // push parser input ran out, rest comes with next chunk
+	int partial; // PARTIAL_* token cut by the end of push parser input, its text so far is kept
+	bool partial_escaped; // partial string ended with backslash
+	size_t mark; // offset in window of cut token that must be lexed again, or NO_MARK
+	aojls_deserialization_prefs* prefs;
+	bool borrow; // strings point into the source
+	bool insitu; // strings are decoded in the source
+	input_t in;
+	char ib;
+	long readc;
+	scan_function_t scan_string;
+	scan_function_t skip_whitespace;
+} tokenizer_t;
 
+static inline int emit_token(json_token_t* token, char* data, size_t len, json_token_type_t type) {
 	token->type = type;
 	token->len = len;
 	token->value = data;
+	token->flags = 0;
+	return 1;
+}
+
+static bool init_tokenizer(tokenizer_t* tokenizer, aojls_deserialization_prefs* prefs, _aojls_arena_t* scratch) {
+	tokenizer->has_token = false;
+	tokenizer->eof = false;
+	tokenizer->status = 0;
+	tokenizer->starved = false;
+	tokenizer->partial = 0;
+	tokenizer->partial_escaped = false;
+	tokenizer->mark = NO_MARK;
+	tokenizer->prefs = prefs;
+
+	string_buffer_data_t* data = &tokenizer->text;
+	data->offset = 0;
+	data->len = 32;
+	data->allocator = &prefs->ctx->allocator;
+	data->arena = scratch;
+	data->data = (char*)arena_alloc(data->arena, data->len);
+	if (data->data == NULL) {
+		return false;
+	}
+
+	input_t* in = &tokenizer->in;
+	in->prefs = prefs;
+	in->data = NULL;
+	in->len = 0;
+	in->pos = 0;
+	in->buffer = NULL;
+	in->buffer_size = 0;
+	if (prefs->chunk_reader == NULL) {
+		in->buffer_size = prefs->read_buffer_size > 0 ? prefs->read_buffer_size : AOJLS_READ_BUFFER_SIZE;
+		in->buffer = (char*)arena_alloc(scratch, in->buffer_size);
+		if (in->buffer == NULL) {
+			return false;
+		}
+	}
+
+	select_scanners(&tokenizer->scan_string, &tokenizer->skip_whitespace);
+
+	tokenizer->readc = input_next(in, &tokenizer->ib);
 	return true;
 }
 
-json_token_t* create_token_stream(aojls_deserialization_prefs* prefs, size_t* count) {
-	size_t numtokens = 0;
-	size_t bflen = 32;
-	json_token_t* tbuf = (json_token_t*)malloc(sizeof(json_token_t)*bflen);
-	string_buffer_data_t* data = NULL;
-	if (tbuf == NULL) {
-		goto memerror;
+static int emit_number(tokenizer_t* tokenizer, json_token_t* token, const char* span, size_t len) {
+	int flags = number_flags(span, len);
+	if (flags < 0) {
+		tokenizer->prefs->error = "tokenstream: malformed number";
+		return -1;
 	}
-	char ib[1];
-	long readc = prefs->reader(ib, 1, prefs->reader_data);
-	data = (string_buffer_data_t*)calloc(1, sizeof(string_buffer_data_t));
-	if (data == NULL) {
-		goto memerror;
+	// span in the window stays valid until the lexer reads past it, parser converts it before that
+	emit_token(token, (char*)span, len, NUMBER);
+	token->flags = flags;
+	return 1;
+}
+
+// collects rest of the number into the token buffer
+static int lex_number_tail(tokenizer_t* tokenizer, json_token_t* token, string_buffer_data_t* data) {
+	input_t* in = &tokenizer->in;
+	while (tokenizer->readc == 1 && is_number_char(tokenizer->ib)) {
+		if (!string_writer_function(&tokenizer->ib, 1, data)) {
+			tokenizer->prefs->error = "tokenstream: memory error";
+			return -1;
+		}
+		tokenizer->readc = input_next(in, &tokenizer->ib);
 	}
-	data->len = 16;
-	data->data = calloc(data->len, sizeof(char));
-	if (data->data == NULL) {
-		goto memerror;
+	if (tokenizer->starved) {
+		// number continues in the next chunk
+		tokenizer->partial = PARTIAL_NUMBER;
+		return 0;
 	}
+	return emit_number(tokenizer, token, data->data, data->offset);
+}
 
-	bool in_string = false;
-	bool escaped = false;
-
-	size_t truep = 0;
-	size_t falsep = 0;
-	size_t nullp = 0;
+static int lex_number(tokenizer_t* tokenizer, json_token_t* token, string_buffer_data_t* data, char first) {
+	input_t* in = &tokenizer->in;
 
-	while (true) {
-		if (readc < 0) {
-			prefs->error = "tokenstream: failed to read data";
-			goto cleanup;
+	if (tokenizer->readc == 1 && in->pos >= 2) {
+		// first char and lookahead are both in the current window, number can be lent in place
+		const char* start = in->data + in->pos - 2;
+		const char* end = in->data + in->len;
+		const char* c = start + 1;
+		while (c < end && is_number_char(*c))
+			++c;
+		if (c < end) {
+			in->pos = c - in->data;
+			tokenizer->readc = input_next(in, &tokenizer->ib);
+			return emit_number(tokenizer, token, start, c - start);
 		}
+	}
 
-		if (truep == 4) {
-			if (!append_token(&tbuf, &bflen, &numtokens, NULL, 0, _TRUE)) {
-				goto memerror;
-			}
-			truep = 0;
-		}
+	// number crosses the window boundary, collect it in the token buffer
+	data->offset = 0;
+	if (!string_writer_function(&first, 1, data)) {
+		tokenizer->prefs->error = "tokenstream: memory error";
+		return -1;
+	}
+	return lex_number_tail(tokenizer, token, data);
+}
 
-		if (falsep ==5) {
-			if (!append_token(&tbuf, &bflen, &numtokens, NULL, 0, _FALSE)) {
-				goto memerror;
+// lexes string body in place, source is single window that outlives the context
+static int lex_borrowed_string(tokenizer_t* tokenizer, json_token_t* token) {
+	input_t* in = &tokenizer->in;
+	int flags = STRING_BORROWED;
+
+	if (tokenizer->readc != 1)
+		goto eof;
+
+	const char* start = in->data + in->pos - 1;
+	const char* end = in->data + in->len;
+	const char* c = start;
+	while (true) {
+		c = tokenizer->scan_string(c, end);
+		if (c == end)
+			goto eof;
+		if (*c == '"')
+			break;
+		if (*c == '\\') {
+			if (c+1 == end)
+				goto eof;
+			switch (c[1]) {
+			case 'b': case 'f': case 'n': case 'r': case 't':
+			case '"': case '/': case 'u': case '\\':
+				break;
+			default:
+				tokenizer->prefs->error = "tokenstream: unknown escape sequence";
+				return -1;
 			}
-			falsep = 0;
-		}
+			flags |= STRING_ESCAPED;
+			c += 2;
+		} else
+			++c;
+	}
+
+	in->pos = c + 1 - in->data;
+	tokenizer->readc = input_next(in, &tokenizer->ib);
+
+	size_t len = c - start;
+	if (tokenizer->insitu) {
+		// decoded string is never longer, so it fits in place and terminator overwrites at most closing quote
+		char* string = (char*)start;
+		if (flags & STRING_ESCAPED)
+			len = unescape(string, string, len);
+		string[len] = '\0';
+		flags = STRING_INSITU;
+	}
+	emit_token(token, (char*)start, len, STRING);
+	token->flags = flags;
+	return 1;
+
+eof:
+	tokenizer->prefs->error = "tokenstream: eof in the middle of a token";
+	return -1;
+}
+
+// lexes rest of the string into the token buffer, resume continues partial string
+static int lex_string(tokenizer_t* tokenizer, json_token_t* token, string_buffer_data_t* data, bool resume) {
+	aojls_deserialization_prefs* prefs = tokenizer->prefs;
+	input_t* in = &tokenizer->in;
+	bool escaped = false;
 
-		if (nullp == 4) {
-			if (!append_token(&tbuf, &bflen, &numtokens, NULL, 0, _NULL)) {
-				goto memerror;
+	if (resume)
+		escaped = tokenizer->partial_escaped;
+	else
+		data->offset = 0;
+	while (true) {
+		if (tokenizer->readc < 0) {
+			prefs->error = "tokenstream: failed to read data";
+			return -1;
+		}
+		if (tokenizer->readc == 0) {
+			if (tokenizer->starved) {
+				// string continues in the next chunk, only the escape state is needed besides its text
+				tokenizer->partial = PARTIAL_STRING;
+				tokenizer->partial_escaped = escaped;
+				return 0;
 			}
-			nullp = 0;
+			prefs->error = "tokenstream: eof in the middle of a token";
+			return -1;
 		}
 
-		if (readc == 0) {
-			if (in_string || escaped) {
-				prefs->error = "tokenstream: eof in the middle of a token";
-				goto cleanup;
+		if (!escaped) {
+			// lookahead char is the last char read from the window, scan the window from it in bulk
+			const char* start = in->data + in->pos - 1;
+			const char* stop = tokenizer->scan_string(start, in->data + in->len);
+			if (stop != start) {
+				if (!string_writer_function(start, stop - start, data)) {
+					goto memerror;
+				}
+				in->pos = stop - in->data;
+				tokenizer->readc = input_next(in, &tokenizer->ib);
+				continue;
 			}
-			break;
 		}
 
-		char current = ib[0];
-		readc = prefs->reader(ib, 1, prefs->reader_data);
+		char current = tokenizer->ib;
+		tokenizer->readc = input_next(in, &tokenizer->ib);
 
-		if (in_string) {
-			if (!escaped && current == '"') {
-				in_string = false;
-				if (!append_token(&tbuf, &bflen, &numtokens, data->data, data->offset, STRING)) {
-					goto memerror;
-				}
-				free(data);
-				data = (string_buffer_data_t*)calloc(1, sizeof(string_buffer_data_t));
-				if (data == NULL) {
+		if (!escaped && current == '"') {
+			return emit_token(token, data->data, data->offset, STRING);
+		}
+		if (escaped) {
+			switch (current) {
+			case 'b': current = '\b'; break;
+			case 'f': current = '\f'; break;
+			case 'n': current = '\n'; break;
+			case 'r': current = '\r'; break;
+			case 't': current = '\t'; break;
+			case '"': current = '"'; break;
+			case '/': current = '/'; break;
+			case 'u':
+				if (!string_writer_function("\\", 1, data)) {
 					goto memerror;
 				}
-				data->len = 16;
-				data->data = calloc(data->len, sizeof(char));
-				if (data->data == NULL) {
-					goto memerror;
-				}
-			} else {
-				if (escaped) {
-					switch (current) {
-					case 'b': current = '\b'; break;
-					case 'f': current = '\f'; break;
-					case 'n': current = '\n'; break;
-					case 'r': current = '\r'; break;
-					case 't': current = '\t'; break;
-					case '"': current = '"'; break;
-					case '/': current = '/'; break;
-					case 'u':
-						if (!string_writer_function("\\", 1, data)) {
-							goto memerror;
-						}
-						break;
-					case '\\': current = '\\'; break;
-					default:
-						prefs->error = "tokenstream: unknown escape sequence";
-						goto cleanup;
-					}
-				} else if (current == '\\') {
-					escaped = true;
-					continue;
-				}
-				if (!string_writer_function(&current, 1, data)) {
-					goto memerror;
-				}
-				escaped = false;
-			}
-		} else {
-			switch (current) {
-			case 0x20:
-			case 0x09:
-			case 0x0A:
-			case 0x0D:
-				if (falsep > 0 || truep > 0 || nullp > 0) {
-					prefs->error = "tokenstream: incorrect token, expected keyword continuation, got whitespace";
-					goto cleanup;
-				}
 				break;
+			case '\\': current = '\\'; break;
+			default:
+				prefs->error = "tokenstream: unknown escape sequence";
+				return -1;
+			}
+		} else if (current == '\\') {
+			escaped = true;
+			continue;
+		}
+		if (!string_writer_function(&current, 1, data)) {
+			goto memerror;
+		}
+		escaped = false;
+	}
 
-			case 'e':
-				if (falsep == 4) {
-					++falsep;
-					break;
-				} else if (truep == 3) {
-					++truep;
-					break;
-				}
-				/* no break */
-            // fall through
-			case 'E':
-				if (falsep > 0 || truep > 0 || nullp > 0) {
-					prefs->error = "tokenstream: incorrect token, expected keyword continuation, got e/E instead";
-					goto cleanup;
-				}
-
-				if (!append_token(&tbuf, &bflen, &numtokens, NULL, 0, E)) {
-					goto memerror;
-				}
-				break;
-			case '0':
-			case '1':
-			case '2':
-			case '3':
-			case '4':
-			case '5':
-			case '6':
-			case '7':
-			case '8':
-			case '9':
-				if (falsep > 0 || truep > 0 || nullp > 0) {
-					prefs->error = "tokenstream: incorrect token, expected keyword continuation, got digit instead";
-					goto cleanup;
-				}
-
-				char* str = malloc(sizeof(char)*2);
-				if (str == NULL) {
-					goto memerror;
-				}
-
-				str[0] = current;
-				str[1] = '\0';
-
-				if (!append_token(&tbuf, &bflen, &numtokens, str, 1, DIGIT)) {
-					goto memerror;
-				}
-				break;
-			case '"':
-				if (falsep > 0 || truep > 0 || nullp > 0) {
-					prefs->error = "tokenstream: incorrect token, expected keyword continuation, got \" instead";
-					goto cleanup;
-				}
+memerror:
+	prefs->error = "tokenstream: memory error";
+	return -1;
+}
+
+static const char* keyword_error(char c) {
+	switch (c) {
+	case 0x20:
+	case 0x09:
+	case 0x0A:
+	case 0x0D:
+		return "tokenstream: incorrect token, expected keyword continuation, got whitespace";
+	case 'e':
+	case 'E':
+		return "tokenstream: incorrect token, expected keyword continuation, got e/E instead";
+	case '0': case '1': case '2': case '3': case '4':
+	case '5': case '6': case '7': case '8': case '9':
+		return "tokenstream: incorrect token, expected keyword continuation, got digit instead";
+	case '-': return "tokenstream: incorrect token, expected keyword continuation, got - instead";
+	case '"': return "tokenstream: incorrect token, expected keyword continuation, got \" instead";
+	case '{': return "tokenstream: incorrect token, expected keyword continuation, got { instead";
+	case '}': return "tokenstream: incorrect token, expected keyword continuation, got } instead";
+	case '[': return "tokenstream: incorrect token, expected keyword continuation, got [ instead";
+	case ']': return "tokenstream: incorrect token, expected keyword continuation, got ] instead";
+	case ':': return "tokenstream: incorrect token, expected keyword continuation, got : instead";
+	case ',': return "tokenstream: incorrect token, expected keyword continuation, got , instead";
+	case 't': return "tokenstream: incorrect token, expected keyword continuation, got t instead";
+	case 'r': return "tokenstream: incorrect token, expected keyword continuation, got r instead";
+	case 'u': return "tokenstream: incorrect token, expected keyword continuation, got u instead";
+	case 'f': return "tokenstream: incorrect token, expected keyword continuation, got f instead";
+	case 'a': return "tokenstream: incorrect token, expected keyword continuation, got a instead";
+	case 'l': return "tokenstream: incorrect token, expected keyword continuation, got l instead";
+	case 's': return "tokenstream: incorrect token, expected keyword continuation, got s instead";
+	case 'n': return "tokenstream: incorrect token, expected keyword continuation, got n instead";
+	default:
+		return "tokenstream: incorrect character in token stream";
+	}
+}
 
-				in_string = true;
-				break;
-			case '{':
-				if (falsep > 0 || truep > 0 || nullp > 0) {
-					prefs->error = "tokenstream: incorrect token, expected keyword continuation, got { instead";
-					goto cleanup;
-				}
+static int end_keyword(tokenizer_t* tokenizer, json_token_t* token, json_token_type_t type) {
+	// keyword directly followed by a letter is reported as wrong keyword continuation
+	char c = tokenizer->ib;
+	if (tokenizer->readc == 1 && ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'))) {
+		tokenizer->prefs->error = keyword_error(c);
+		return -1;
+	}
+	return emit_token(token, NULL, 0, type);
+}
 
-				if (!append_token(&tbuf, &bflen, &numtokens, NULL, 0, LEFT_CURLY)) {
-					goto memerror;
-				}
-				break;
-			case '}':
-				if (falsep > 0 || truep > 0 || nullp > 0) {
-					prefs->error = "tokenstream: incorrect token, expected keyword continuation, got } instead";
-					goto cleanup;
-				}
+// matches rest of the keyword whose first char was already read
+static int lex_keyword(tokenizer_t* tokenizer, json_token_t* token, const char* keyword, size_t len,
+		json_token_type_t type) {
+	input_t* in = &tokenizer->in;
 
-				if (!append_token(&tbuf, &bflen, &numtokens, NULL, 0, RIGHT_CURLY)) {
-					goto memerror;
-				}
-				break;
-			case '[':
-				if (falsep > 0 || truep > 0 || nullp > 0) {
-					prefs->error = "tokenstream: incorrect token, expected keyword continuation, got [ instead";
-					goto cleanup;
-				}
-
-				if (!append_token(&tbuf, &bflen, &numtokens, NULL, 0, LEFT_SQUARE)) {
-					goto memerror;
-				}
-				break;
-			case ']':
-				if (falsep > 0 || truep > 0 || nullp > 0) {
-					prefs->error = "tokenstream: incorrect token, expected keyword continuation, got ] instead";
-					goto cleanup;
-				}
+	if (tokenizer->readc == 1) {
+		// whole keyword in the window is compared at once
+		const char* start = in->data + in->pos - 1;
+		if ((size_t)(in->data + in->len - start) >= len - 1 && memcmp(start, keyword + 1, len - 1) == 0) {
+			in->pos = start + len - 1 - in->data;
+			tokenizer->readc = input_next(in, &tokenizer->ib);
+			return end_keyword(tokenizer, token, type);
+		}
+	}
 
-				if (!append_token(&tbuf, &bflen, &numtokens, NULL, 0, RIGHT_SQUARE)) {
-					goto memerror;
-				}
-				break;
-			case '+':
-				if (falsep > 0 || truep > 0 || nullp > 0) {
-					prefs->error = "tokenstream: incorrect token, expected keyword continuation, got + instead";
-					goto cleanup;
-				}
+	// keyword crosses the window boundary or does not match
+	for (size_t i=1; i<len; i++) {
+		if (tokenizer->readc < 0) {
+			tokenizer->prefs->error = "tokenstream: failed to read data";
+			return -1;
+		}
+		if (tokenizer->readc == 0)
+			return 0;
+		if (tokenizer->ib != keyword[i]) {
+			tokenizer->prefs->error = keyword_error(tokenizer->ib);
+			return -1;
+		}
+		tokenizer->readc = input_next(in, &tokenizer->ib);
+	}
+	return end_keyword(tokenizer, token, type);
+}
 
-				if (!append_token(&tbuf, &bflen, &numtokens, NULL, 0, PLUS)) {
-					goto memerror;
-				}
-				break;
-			case '-':
-				if (falsep > 0 || truep > 0 || nullp > 0) {
-					prefs->error = "tokenstream: incorrect token, expected keyword continuation, got - instead";
-					goto cleanup;
-				}
+// lexes next token, returns 1 if token was read, 0 on eof and -1 on error
+static int lex_token(tokenizer_t* tokenizer, json_token_t* token, string_buffer_data_t* data) {
+	aojls_deserialization_prefs* prefs = tokenizer->prefs;
+	input_t* in = &tokenizer->in;
 
-				if (!append_token(&tbuf, &bflen, &numtokens, NULL, 0, MINUS)) {
-					goto memerror;
-				}
-				break;
-			case '.':
-				if (falsep > 0 || truep > 0 || nullp > 0) {
-					prefs->error = "tokenstream: incorrect token, expected keyword continuation, got . instead";
-					goto cleanup;
-				}
+	if (tokenizer->partial != 0) {
+		// token cut by the end of previous chunk continues
+		int partial = tokenizer->partial;
+		tokenizer->partial = 0;
+		if (partial == PARTIAL_STRING)
+			return lex_string(tokenizer, token, data, true);
+		return lex_number_tail(tokenizer, token, data);
+	}
 
+	while (true) {
+		if (tokenizer->readc < 0) {
+			prefs->error = "tokenstream: failed to read data";
+			return -1;
+		}
+		if (tokenizer->readc == 0) {
+			return 0;
+		}
 
-				if (!append_token(&tbuf, &bflen, &numtokens, NULL, 0, DOT)) {
-					goto memerror;
-				}
-				break;
-			case ':':
-				if (falsep > 0 || truep > 0 || nullp > 0) {
-					prefs->error = "tokenstream: incorrect token, expected keyword continuation, got : instead";
-					goto cleanup;
-				}
+		// lookahead char is the last char read from the window, skip whitespace from it in bulk
+		const char* start = in->data + in->pos - 1;
+		const char* stop = tokenizer->skip_whitespace(start, in->data + in->len);
+		if (stop != start) {
+			in->pos = stop - in->data;
+			tokenizer->readc = input_next(in, &tokenizer->ib);
+			continue;
+		}
 
-				if (!append_token(&tbuf, &bflen, &numtokens, NULL, 0, COLON)) {
-					goto memerror;
-				}
-				break;
-			case ',':
-				if (falsep > 0 || truep > 0 || nullp > 0) {
-					prefs->error = "tokenstream: incorrect token, expected keyword continuation, got , instead";
-					goto cleanup;
-				}
+		char current = tokenizer->ib;
+		tokenizer->mark = in->pos - 1;
+		tokenizer->readc = input_next(in, &tokenizer->ib);
 
-				if (!append_token(&tbuf, &bflen, &numtokens, NULL, 0, COMMA)) {
-					goto memerror;
-				}
-				break;
-			case 't':
-				if (falsep > 0 || nullp > 0 || truep != 0) {
-					prefs->error = "tokenstream: incorrect token, expected keyword continuation, got t instead";
-					goto cleanup;
-				}
-				++truep;
-				break;
-			case 'r':
-				if (falsep > 0 || nullp > 0 || truep != 1) {
-					prefs->error = "tokenstream: incorrect token, expected keyword continuation, got r instead";
-					goto cleanup;
-				}
-				++truep;
-				break;
-			case 'u':
-				if (falsep > 0 || (nullp != 1 && truep != 2)) {
-					prefs->error = "tokenstream: incorrect token, expected keyword continuation, got u instead";
-					goto cleanup;
-				}
-				if (nullp != 1)
-					++truep;
-				else
-					++nullp;
-				break;
-			case 'f':
-				if (falsep != 0 || nullp > 0 || truep > 0) {
-					prefs->error = "tokenstream: incorrect token, expected keyword continuation, got f instead";
-					goto cleanup;
-				}
-				++falsep;
-				break;
-			case 'a':
-				if (falsep != 1 || nullp > 0 || truep > 0) {
-					prefs->error = "tokenstream: incorrect token, expected keyword continuation, got a instead";
-					goto cleanup;
-				}
-				++falsep;
-				break;
-			case 'l':
-				if (truep > 0 || (falsep != 2 && nullp != 2 && nullp != 3)) {
-					prefs->error = "tokenstream: incorrect token, expected keyword continuation, got l instead";
-					goto cleanup;
-				}
-				if (falsep == 2)
-					++falsep;
-				else
-					++nullp;
-				break;
-			case 's':
-				if (falsep != 3 || nullp > 0 || truep > 0) {
-					prefs->error = "tokenstream: incorrect token, expected keyword continuation, got s instead";
-					goto cleanup;
-				}
-				++falsep;
-				break;
-			case 'n':
-				if (falsep > 0 || nullp != 0 || truep > 0) {
-					prefs->error = "tokenstream: incorrect token, expected keyword continuation, got n instead";
-					goto cleanup;
-				}
-				++nullp;
-				break;
-			default:
-				prefs->error = "tokenstream: incorrect character in token stream";
-				goto cleanup;
-			}
+		switch (char_class[(unsigned char)current]) {
+		case CC_SPACE:
+			break;
+		case CC_LEFT_CURLY:
+			return emit_token(token, NULL, 0, LEFT_CURLY);
+		case CC_RIGHT_CURLY:
+			return emit_token(token, NULL, 0, RIGHT_CURLY);
+		case CC_LEFT_SQUARE:
+			return emit_token(token, NULL, 0, LEFT_SQUARE);
+		case CC_RIGHT_SQUARE:
+			return emit_token(token, NULL, 0, RIGHT_SQUARE);
+		case CC_COLON:
+			return emit_token(token, NULL, 0, COLON);
+		case CC_COMMA:
+			return emit_token(token, NULL, 0, COMMA);
+		case CC_QUOTE:
+			if (tokenizer->borrow)
+				return lex_borrowed_string(tokenizer, token);
+			return lex_string(tokenizer, token, data, false);
+		case CC_NUMBER:
+			return lex_number(tokenizer, token, data, current);
+		case CC_TRUE:
+			return lex_keyword(tokenizer, token, "true", 4, _TRUE);
+		case CC_FALSE:
+			return lex_keyword(tokenizer, token, "false", 5, _FALSE);
+		case CC_NULL:
+			return lex_keyword(tokenizer, token, "null", 4, _NULL);
+		default:
+			prefs->error = "tokenstream: incorrect character in token stream";
+			return -1;
 		}
 	}
+}
 
-	*count = numtokens;
-	free(data->data);
-	free(data);
-	return tbuf;
-
-memerror:
-	prefs->error = "tokenstream: memory error";
-cleanup:
-	for (size_t i=0; i<numtokens; i++) {
-		free(tbuf[i].value);
-	}
-	free(tbuf);
-	if (data != NULL)
-		free(data->data);
-	free(data);
-	return NULL;
+static inline bool self_delimited(json_token_type_t type) {
+	// token is complete without looking at the next char
+	return type != NUMBER && type != _TRUE && type != _FALSE && type != _NULL;
 }
 
-typedef struct tokenizer {
-	size_t cpos;
-	size_t total;
-	json_token_t* tokenstream;
-	jmp_buf jmppos;
-} tokenizer_t;
+// returns next token without consuming it, or NULL on eof or lexer failure
+static inline json_token_t* peek(tokenizer_t* tokenizer) {
+	if (!tokenizer->has_token) {
+		if (tokenizer->eof)
+			return NULL;
+		tokenizer->mark = NO_MARK;
+		if (tokenizer->starved)
+			return NULL;
+		int r = lex_token(tokenizer, &tokenizer->token, &tokenizer->text);
+		if (tokenizer->starved && (r == 0 || (r == 1 && !self_delimited(tokenizer->token.type)))) {
+			// push parser input ran out, token is either partial or lexed again with the next chunk,
+			// lexer errors are never caused by missing input
+			if (tokenizer->partial != 0)
+				tokenizer->mark = NO_MARK;
+			return NULL;
+		}
+		if (r < 0) {
+			tokenizer->status = FAIL_TOKENSTREAM;
+			tokenizer->starved = false; // nothing to wait for after an error
+		}
+		if (r <= 0) {
+			tokenizer->eof = true;
+			return NULL;
+		}
+		tokenizer->has_token = true;
+	}
+	return &tokenizer->token;
+}
 
 static inline bool has_next(tokenizer_t* tokenizer) {
-	return tokenizer->cpos < tokenizer->total;
+	return peek(tokenizer) != NULL;
 }
 
+// consumed token stays valid until the next token is peeked
 static inline json_token_t* next(tokenizer_t* tokenizer) {
-	if (!has_next(tokenizer)) {
-		return NULL;
-	} else
-		return &tokenizer->tokenstream[tokenizer->cpos++];
+	json_token_t* token = peek(tokenizer);
+	tokenizer->has_token = false;
+	return token;
 }
 
 static inline bool next_type(tokenizer_t* tokenizer, json_token_type_t ttype) {
-	if (!has_next(tokenizer)) {
-		return false;
-	} else
-		return tokenizer->tokenstream[tokenizer->cpos].type == ttype;
-}
-
-size_t get_current_pos(tokenizer_t* tokenizer) {
-	return tokenizer->cpos;
-}
-
-static inline void set_current_pos(tokenizer_t* tokenizer, size_t cpos) {
-	tokenizer->cpos = cpos;
-}
-
-static inline void fail(tokenizer_t* tokenizer, int status) {
-	longjmp(tokenizer->jmppos, status);
-}
+	json_token_t* token = peek(tokenizer);
+	return token != NULL && token->type == ttype;
+}
+
+/* number conversion */
+
+// 128-bit approximations of 5^q for q in [POW5_MIN, POW5_MAX], high word first,
+// truncated for q >= 0 and rounded up otherwise
+#define POW5_MIN -342
+#define POW5_MAX 308
+
+static const uint64_t pow5_128[2*(POW5_MAX - POW5_MIN + 1)] = {
+	0xeef453d6923bd65aULL, 0x113faa2906a13b3fULL, 0x9558b4661b6565f8ULL, 0x4ac7ca59a424c507ULL,
+	0xbaaee17fa23ebf76ULL, 0x5d79bcf00d2df649ULL, 0xe95a99df8ace6f53ULL, 0xf4d82c2c107973dcULL,
+	0x91d8a02bb6c10594ULL, 0x79071b9b8a4be869ULL, 0xb64ec836a47146f9ULL, 0x9748e2826cdee284ULL,
+	0xe3e27a444d8d98b7ULL, 0xfd1b1b2308169b25ULL, 0x8e6d8c6ab0787f72ULL, 0xfe30f0f5e50e20f7ULL,
+	0xb208ef855c969f4fULL, 0xbdbd2d335e51a935ULL, 0xde8b2b66b3bc4723ULL, 0xad2c788035e61382ULL,
+	0x8b16fb203055ac76ULL, 0x4c3bcb5021afcc31ULL, 0xaddcb9e83c6b1793ULL, 0xdf4abe242a1bbf3dULL,
+	0xd953e8624b85dd78ULL, 0xd71d6dad34a2af0dULL, 0x87d4713d6f33aa6bULL, 0x8672648c40e5ad68ULL,
+	0xa9c98d8ccb009506ULL, 0x680efdaf511f18c2ULL, 0xd43bf0effdc0ba48ULL, 0x0212bd1b2566def2ULL,
+	0x84a57695fe98746dULL, 0x014bb630f7604b57ULL, 0xa5ced43b7e3e9188ULL, 0x419ea3bd35385e2dULL,
+	0xcf42894a5dce35eaULL, 0x52064cac828675b9ULL, 0x818995ce7aa0e1b2ULL, 0x7343efebd1940993ULL,
+	0xa1ebfb4219491a1fULL, 0x1014ebe6c5f90bf8ULL, 0xca66fa129f9b60a6ULL, 0xd41a26e077774ef6ULL,
+	0xfd00b897478238d0ULL, 0x8920b098955522b4ULL, 0x9e20735e8cb16382ULL, 0x55b46e5f5d5535b0ULL,
+	0xc5a890362fddbc62ULL, 0xeb2189f734aa831dULL, 0xf712b443bbd52b7bULL, 0xa5e9ec7501d523e4ULL,
+	0x9a6bb0aa55653b2dULL, 0x47b233c92125366eULL, 0xc1069cd4eabe89f8ULL, 0x999ec0bb696e840aULL,
+	0xf148440a256e2c76ULL, 0xc00670ea43ca250dULL, 0x96cd2a865764dbcaULL, 0x380406926a5e5728ULL,
+	0xbc807527ed3e12bcULL, 0xc605083704f5ecf2ULL, 0xeba09271e88d976bULL, 0xf7864a44c633682eULL,
+	0x93445b8731587ea3ULL, 0x7ab3ee6afbe0211dULL, 0xb8157268fdae9e4cULL, 0x5960ea05bad82964ULL,
+	0xe61acf033d1a45dfULL, 0x6fb92487298e33bdULL, 0x8fd0c16206306babULL, 0xa5d3b6d479f8e056ULL,
+	0xb3c4f1ba87bc8696ULL, 0x8f48a4899877186cULL, 0xe0b62e2929aba83cULL, 0x331acdabfe94de87ULL,
+	0x8c71dcd9ba0b4925ULL, 0x9ff0c08b7f1d0b14ULL, 0xaf8e5410288e1b6fULL, 0x07ecf0ae5ee44dd9ULL,
+	0xdb71e91432b1a24aULL, 0xc9e82cd9f69d6150ULL, 0x892731ac9faf056eULL, 0xbe311c083a225cd2ULL,
+	0xab70fe17c79ac6caULL, 0x6dbd630a48aaf406ULL, 0xd64d3d9db981787dULL, 0x092cbbccdad5b108ULL,
+	0x85f0468293f0eb4eULL, 0x25bbf56008c58ea5ULL, 0xa76c582338ed2621ULL, 0xaf2af2b80af6f24eULL,
+	0xd1476e2c07286faaULL, 0x1af5af660db4aee1ULL, 0x82cca4db847945caULL, 0x50d98d9fc890ed4dULL,
+	0xa37fce126597973cULL, 0xe50ff107bab528a0ULL, 0xcc5fc196fefd7d0cULL, 0x1e53ed49a96272c8ULL,
+	0xff77b1fcbebcdc4fULL, 0x25e8e89c13bb0f7aULL, 0x9faacf3df73609b1ULL, 0x77b191618c54e9acULL,
+	0xc795830d75038c1dULL, 0xd59df5b9ef6a2417ULL, 0xf97ae3d0d2446f25ULL, 0x4b0573286b44ad1dULL,
+	0x9becce62836ac577ULL, 0x4ee367f9430aec32ULL, 0xc2e801fb244576d5ULL, 0x229c41f793cda73fULL,
+	0xf3a20279ed56d48aULL, 0x6b43527578c1110fULL, 0x9845418c345644d6ULL, 0x830a13896b78aaa9ULL,
+	0xbe5691ef416bd60cULL, 0x23cc986bc656d553ULL, 0xedec366b11c6cb8fULL, 0x2cbfbe86b7ec8aa8ULL,
+	0x94b3a202eb1c3f39ULL, 0x7bf7d71432f3d6a9ULL, 0xb9e08a83a5e34f07ULL, 0xdaf5ccd93fb0cc53ULL,
+	0xe858ad248f5c22c9ULL, 0xd1b3400f8f9cff68ULL, 0x91376c36d99995beULL, 0x23100809b9c21fa1ULL,
+	0xb58547448ffffb2dULL, 0xabd40a0c2832a78aULL, 0xe2e69915b3fff9f9ULL, 0x16c90c8f323f516cULL,
+	0x8dd01fad907ffc3bULL, 0xae3da7d97f6792e3ULL, 0xb1442798f49ffb4aULL, 0x99cd11cfdf41779cULL,
+	0xdd95317f31c7fa1dULL, 0x40405643d711d583ULL, 0x8a7d3eef7f1cfc52ULL, 0x482835ea666b2572ULL,
+	0xad1c8eab5ee43b66ULL, 0xda3243650005eecfULL, 0xd863b256369d4a40ULL, 0x90bed43e40076a82ULL,
+	0x873e4f75e2224e68ULL, 0x5a7744a6e804a291ULL, 0xa90de3535aaae202ULL, 0x711515d0a205cb36ULL,
+	0xd3515c2831559a83ULL, 0x0d5a5b44ca873e03ULL, 0x8412d9991ed58091ULL, 0xe858790afe9486c2ULL,
+	0xa5178fff668ae0b6ULL, 0x626e974dbe39a872ULL, 0xce5d73ff402d98e3ULL, 0xfb0a3d212dc8128fULL,
+	0x80fa687f881c7f8eULL, 0x7ce66634bc9d0b99ULL, 0xa139029f6a239f72ULL, 0x1c1fffc1ebc44e80ULL,
+	0xc987434744ac874eULL, 0xa327ffb266b56220ULL, 0xfbe9141915d7a922ULL, 0x4bf1ff9f0062baa8ULL,
+	0x9d71ac8fada6c9b5ULL, 0x6f773fc3603db4a9ULL, 0xc4ce17b399107c22ULL, 0xcb550fb4384d21d3ULL,
+	0xf6019da07f549b2bULL, 0x7e2a53a146606a48ULL, 0x99c102844f94e0fbULL, 0x2eda7444cbfc426dULL,
+	0xc0314325637a1939ULL, 0xfa911155fefb5308ULL, 0xf03d93eebc589f88ULL, 0x793555ab7eba27caULL,
+	0x96267c7535b763b5ULL, 0x4bc1558b2f3458deULL, 0xbbb01b9283253ca2ULL, 0x9eb1aaedfb016f16ULL,
+	0xea9c227723ee8bcbULL, 0x465e15a979c1cadcULL, 0x92a1958a7675175fULL, 0x0bfacd89ec191ec9ULL,
+	0xb749faed14125d36ULL, 0xcef980ec671f667bULL, 0xe51c79a85916f484ULL, 0x82b7e12780e7401aULL,
+	0x8f31cc0937ae58d2ULL, 0xd1b2ecb8b0908810ULL, 0xb2fe3f0b8599ef07ULL, 0x861fa7e6dcb4aa15ULL,
+	0xdfbdcece67006ac9ULL, 0x67a791e093e1d49aULL, 0x8bd6a141006042bdULL, 0xe0c8bb2c5c6d24e0ULL,
+	0xaecc49914078536dULL, 0x58fae9f773886e18ULL, 0xda7f5bf590966848ULL, 0xaf39a475506a899eULL,
+	0x888f99797a5e012dULL, 0x6d8406c952429603ULL, 0xaab37fd7d8f58178ULL, 0xc8e5087ba6d33b83ULL,
+	0xd5605fcdcf32e1d6ULL, 0xfb1e4a9a90880a64ULL, 0x855c3be0a17fcd26ULL, 0x5cf2eea09a55067fULL,
+	0xa6b34ad8c9dfc06fULL, 0xf42faa48c0ea481eULL, 0xd0601d8efc57b08bULL, 0xf13b94daf124da26ULL,
+	0x823c12795db6ce57ULL, 0x76c53d08d6b70858ULL, 0xa2cb1717b52481edULL, 0x54768c4b0c64ca6eULL,
+	0xcb7ddcdda26da268ULL, 0xa9942f5dcf7dfd09ULL, 0xfe5d54150b090b02ULL, 0xd3f93b35435d7c4cULL,
+	0x9efa548d26e5a6e1ULL, 0xc47bc5014a1a6dafULL, 0xc6b8e9b0709f109aULL, 0x359ab6419ca1091bULL,
+	0xf867241c8cc6d4c0ULL, 0xc30163d203c94b62ULL, 0x9b407691d7fc44f8ULL, 0x79e0de63425dcf1dULL,
+	0xc21094364dfb5636ULL, 0x985915fc12f542e4ULL, 0xf294b943e17a2bc4ULL, 0x3e6f5b7b17b2939dULL,
+	0x979cf3ca6cec5b5aULL, 0xa705992ceecf9c42ULL, 0xbd8430bd08277231ULL, 0x50c6ff782a838353ULL,
+	0xece53cec4a314ebdULL, 0xa4f8bf5635246428ULL, 0x940f4613ae5ed136ULL, 0x871b7795e136be99ULL,
+	0xb913179899f68584ULL, 0x28e2557b59846e3fULL, 0xe757dd7ec07426e5ULL, 0x331aeada2fe589cfULL,
+	0x9096ea6f3848984fULL, 0x3ff0d2c85def7621ULL, 0xb4bca50b065abe63ULL, 0x0fed077a756b53a9ULL,
+	0xe1ebce4dc7f16dfbULL, 0xd3e8495912c62894ULL, 0x8d3360f09cf6e4bdULL, 0x64712dd7abbbd95cULL,
+	0xb080392cc4349decULL, 0xbd8d794d96aacfb3ULL, 0xdca04777f541c567ULL, 0xecf0d7a0fc5583a0ULL,
+	0x89e42caaf9491b60ULL, 0xf41686c49db57244ULL, 0xac5d37d5b79b6239ULL, 0x311c2875c522ced5ULL,
+	0xd77485cb25823ac7ULL, 0x7d633293366b828bULL, 0x86a8d39ef77164bcULL, 0xae5dff9c02033197ULL,
+	0xa8530886b54dbdebULL, 0xd9f57f830283fdfcULL, 0xd267caa862a12d66ULL, 0xd072df63c324fd7bULL,
+	0x8380dea93da4bc60ULL, 0x4247cb9e59f71e6dULL, 0xa46116538d0deb78ULL, 0x52d9be85f074e608ULL,
+	0xcd795be870516656ULL, 0x67902e276c921f8bULL, 0x806bd9714632dff6ULL, 0x00ba1cd8a3db53b6ULL,
+	0xa086cfcd97bf97f3ULL, 0x80e8a40eccd228a4ULL, 0xc8a883c0fdaf7df0ULL, 0x6122cd128006b2cdULL,
+	0xfad2a4b13d1b5d6cULL, 0x796b805720085f81ULL, 0x9cc3a6eec6311a63ULL, 0xcbe3303674053bb0ULL,
+	0xc3f490aa77bd60fcULL, 0xbedbfc4411068a9cULL, 0xf4f1b4d515acb93bULL, 0xee92fb5515482d44ULL,
+	0x991711052d8bf3c5ULL, 0x751bdd152d4d1c4aULL, 0xbf5cd54678eef0b6ULL, 0xd262d45a78a0635dULL,
+	0xef340a98172aace4ULL, 0x86fb897116c87c34ULL, 0x9580869f0e7aac0eULL, 0xd45d35e6ae3d4da0ULL,
+	0xbae0a846d2195712ULL, 0x8974836059cca109ULL, 0xe998d258869facd7ULL, 0x2bd1a438703fc94bULL,
+	0x91ff83775423cc06ULL, 0x7b6306a34627ddcfULL, 0xb67f6455292cbf08ULL, 0x1a3bc84c17b1d542ULL,
+	0xe41f3d6a7377eecaULL, 0x20caba5f1d9e4a93ULL, 0x8e938662882af53eULL, 0x547eb47b7282ee9cULL,
+	0xb23867fb2a35b28dULL, 0xe99e619a4f23aa43ULL, 0xdec681f9f4c31f31ULL, 0x6405fa00e2ec94d4ULL,
+	0x8b3c113c38f9f37eULL, 0xde83bc408dd3dd04ULL, 0xae0b158b4738705eULL, 0x9624ab50b148d445ULL,
+	0xd98ddaee19068c76ULL, 0x3badd624dd9b0957ULL, 0x87f8a8d4cfa417c9ULL, 0xe54ca5d70a80e5d6ULL,
+	0xa9f6d30a038d1dbcULL, 0x5e9fcf4ccd211f4cULL, 0xd47487cc8470652bULL, 0x7647c3200069671fULL,
+	0x84c8d4dfd2c63f3bULL, 0x29ecd9f40041e073ULL, 0xa5fb0a17c777cf09ULL, 0xf468107100525890ULL,
+	0xcf79cc9db955c2ccULL, 0x7182148d4066eeb4ULL, 0x81ac1fe293d599bfULL, 0xc6f14cd848405530ULL,
+	0xa21727db38cb002fULL, 0xb8ada00e5a506a7cULL, 0xca9cf1d206fdc03bULL, 0xa6d90811f0e4851cULL,
+	0xfd442e4688bd304aULL, 0x908f4a166d1da663ULL, 0x9e4a9cec15763e2eULL, 0x9a598e4e043287feULL,
+	0xc5dd44271ad3cdbaULL, 0x40eff1e1853f29fdULL, 0xf7549530e188c128ULL, 0xd12bee59e68ef47cULL,
+	0x9a94dd3e8cf578b9ULL, 0x82bb74f8301958ceULL, 0xc13a148e3032d6e7ULL, 0xe36a52363c1faf01ULL,
+	0xf18899b1bc3f8ca1ULL, 0xdc44e6c3cb279ac1ULL, 0x96f5600f15a7b7e5ULL, 0x29ab103a5ef8c0b9ULL,
+	0xbcb2b812db11a5deULL, 0x7415d448f6b6f0e7ULL, 0xebdf661791d60f56ULL, 0x111b495b3464ad21ULL,
+	0x936b9fcebb25c995ULL, 0xcab10dd900beec34ULL, 0xb84687c269ef3bfbULL, 0x3d5d514f40eea742ULL,
+	0xe65829b3046b0afaULL, 0x0cb4a5a3112a5112ULL, 0x8ff71a0fe2c2e6dcULL, 0x47f0e785eaba72abULL,
+	0xb3f4e093db73a093ULL, 0x59ed216765690f56ULL, 0xe0f218b8d25088b8ULL, 0x306869c13ec3532cULL,
+	0x8c974f7383725573ULL, 0x1e414218c73a13fbULL, 0xafbd2350644eeacfULL, 0xe5d1929ef90898faULL,
+	0xdbac6c247d62a583ULL, 0xdf45f746b74abf39ULL, 0x894bc396ce5da772ULL, 0x6b8bba8c328eb783ULL,
+	0xab9eb47c81f5114fULL, 0x066ea92f3f326564ULL, 0xd686619ba27255a2ULL, 0xc80a537b0efefebdULL,
+	0x8613fd0145877585ULL, 0xbd06742ce95f5f36ULL, 0xa798fc4196e952e7ULL, 0x2c48113823b73704ULL,
+	0xd17f3b51fca3a7a0ULL, 0xf75a15862ca504c5ULL, 0x82ef85133de648c4ULL, 0x9a984d73dbe722fbULL,
+	0xa3ab66580d5fdaf5ULL, 0xc13e60d0d2e0ebbaULL, 0xcc963fee10b7d1b3ULL, 0x318df905079926a8ULL,
+	0xffbbcfe994e5c61fULL, 0xfdf17746497f7052ULL, 0x9fd561f1fd0f9bd3ULL, 0xfeb6ea8bedefa633ULL,
+	0xc7caba6e7c5382c8ULL, 0xfe64a52ee96b8fc0ULL, 0xf9bd690a1b68637bULL, 0x3dfdce7aa3c673b0ULL,
+	0x9c1661a651213e2dULL, 0x06bea10ca65c084eULL, 0xc31bfa0fe5698db8ULL, 0x486e494fcff30a62ULL,
+	0xf3e2f893dec3f126ULL, 0x5a89dba3c3efccfaULL, 0x986ddb5c6b3a76b7ULL, 0xf89629465a75e01cULL,
+	0xbe89523386091465ULL, 0xf6bbb397f1135823ULL, 0xee2ba6c0678b597fULL, 0x746aa07ded582e2cULL,
+	0x94db483840b717efULL, 0xa8c2a44eb4571cdcULL, 0xba121a4650e4ddebULL, 0x92f34d62616ce413ULL,
+	0xe896a0d7e51e1566ULL, 0x77b020baf9c81d17ULL, 0x915e2486ef32cd60ULL, 0x0ace1474dc1d122eULL,
+	0xb5b5ada8aaff80b8ULL, 0x0d819992132456baULL, 0xe3231912d5bf60e6ULL, 0x10e1fff697ed6c69ULL,
+	0x8df5efabc5979c8fULL, 0xca8d3ffa1ef463c1ULL, 0xb1736b96b6fd83b3ULL, 0xbd308ff8a6b17cb2ULL,
+	0xddd0467c64bce4a0ULL, 0xac7cb3f6d05ddbdeULL, 0x8aa22c0dbef60ee4ULL, 0x6bcdf07a423aa96bULL,
+	0xad4ab7112eb3929dULL, 0x86c16c98d2c953c6ULL, 0xd89d64d57a607744ULL, 0xe871c7bf077ba8b7ULL,
+	0x87625f056c7c4a8bULL, 0x11471cd764ad4972ULL, 0xa93af6c6c79b5d2dULL, 0xd598e40d3dd89bcfULL,
+	0xd389b47879823479ULL, 0x4aff1d108d4ec2c3ULL, 0x843610cb4bf160cbULL, 0xcedf722a585139baULL,
+	0xa54394fe1eedb8feULL, 0xc2974eb4ee658828ULL, 0xce947a3da6a9273eULL, 0x733d226229feea32ULL,
+	0x811ccc668829b887ULL, 0x0806357d5a3f525fULL, 0xa163ff802a3426a8ULL, 0xca07c2dcb0cf26f7ULL,
+	0xc9bcff6034c13052ULL, 0xfc89b393dd02f0b5ULL, 0xfc2c3f3841f17c67ULL, 0xbbac2078d443ace2ULL,
+	0x9d9ba7832936edc0ULL, 0xd54b944b84aa4c0dULL, 0xc5029163f384a931ULL, 0x0a9e795e65d4df11ULL,
+	0xf64335bcf065d37dULL, 0x4d4617b5ff4a16d5ULL, 0x99ea0196163fa42eULL, 0x504bced1bf8e4e45ULL,
+	0xc06481fb9bcf8d39ULL, 0xe45ec2862f71e1d6ULL, 0xf07da27a82c37088ULL, 0x5d767327bb4e5a4cULL,
+	0x964e858c91ba2655ULL, 0x3a6a07f8d510f86fULL, 0xbbe226efb628afeaULL, 0x890489f70a55368bULL,
+	0xeadab0aba3b2dbe5ULL, 0x2b45ac74ccea842eULL, 0x92c8ae6b464fc96fULL, 0x3b0b8bc90012929dULL,
+	0xb77ada0617e3bbcbULL, 0x09ce6ebb40173744ULL, 0xe55990879ddcaabdULL, 0xcc420a6a101d0515ULL,
+	0x8f57fa54c2a9eab6ULL, 0x9fa946824a12232dULL, 0xb32df8e9f3546564ULL, 0x47939822dc96abf9ULL,
+	0xdff9772470297ebdULL, 0x59787e2b93bc56f7ULL, 0x8bfbea76c619ef36ULL, 0x57eb4edb3c55b65aULL,
+	0xaefae51477a06b03ULL, 0xede622920b6b23f1ULL, 0xdab99e59958885c4ULL, 0xe95fab368e45ecedULL,
+	0x88b402f7fd75539bULL, 0x11dbcb0218ebb414ULL, 0xaae103b5fcd2a881ULL, 0xd652bdc29f26a119ULL,
+	0xd59944a37c0752a2ULL, 0x4be76d3346f0495fULL, 0x857fcae62d8493a5ULL, 0x6f70a4400c562ddbULL,
+	0xa6dfbd9fb8e5b88eULL, 0xcb4ccd500f6bb952ULL, 0xd097ad07a71f26b2ULL, 0x7e2000a41346a7a7ULL,
+	0x825ecc24c873782fULL, 0x8ed400668c0c28c8ULL, 0xa2f67f2dfa90563bULL, 0x728900802f0f32faULL,
+	0xcbb41ef979346bcaULL, 0x4f2b40a03ad2ffb9ULL, 0xfea126b7d78186bcULL, 0xe2f610c84987bfa8ULL,
+	0x9f24b832e6b0f436ULL, 0x0dd9ca7d2df4d7c9ULL, 0xc6ede63fa05d3143ULL, 0x91503d1c79720dbbULL,
+	0xf8a95fcf88747d94ULL, 0x75a44c6397ce912aULL, 0x9b69dbe1b548ce7cULL, 0xc986afbe3ee11abaULL,
+	0xc24452da229b021bULL, 0xfbe85badce996168ULL, 0xf2d56790ab41c2a2ULL, 0xfae27299423fb9c3ULL,
+	0x97c560ba6b0919a5ULL, 0xdccd879fc967d41aULL, 0xbdb6b8e905cb600fULL, 0x5400e987bbc1c920ULL,
+	0xed246723473e3813ULL, 0x290123e9aab23b68ULL, 0x9436c0760c86e30bULL, 0xf9a0b6720aaf6521ULL,
+	0xb94470938fa89bceULL, 0xf808e40e8d5b3e69ULL, 0xe7958cb87392c2c2ULL, 0xb60b1d1230b20e04ULL,
+	0x90bd77f3483bb9b9ULL, 0xb1c6f22b5e6f48c2ULL, 0xb4ecd5f01a4aa828ULL, 0x1e38aeb6360b1af3ULL,
+	0xe2280b6c20dd5232ULL, 0x25c6da63c38de1b0ULL, 0x8d590723948a535fULL, 0x579c487e5a38ad0eULL,
+	0xb0af48ec79ace837ULL, 0x2d835a9df0c6d851ULL, 0xdcdb1b2798182244ULL, 0xf8e431456cf88e65ULL,
+	0x8a08f0f8bf0f156bULL, 0x1b8e9ecb641b58ffULL, 0xac8b2d36eed2dac5ULL, 0xe272467e3d222f3fULL,
+	0xd7adf884aa879177ULL, 0x5b0ed81dcc6abb0fULL, 0x86ccbb52ea94baeaULL, 0x98e947129fc2b4e9ULL,
+	0xa87fea27a539e9a5ULL, 0x3f2398d747b36224ULL, 0xd29fe4b18e88640eULL, 0x8eec7f0d19a03aadULL,
+	0x83a3eeeef9153e89ULL, 0x1953cf68300424acULL, 0xa48ceaaab75a8e2bULL, 0x5fa8c3423c052dd7ULL,
+	0xcdb02555653131b6ULL, 0x3792f412cb06794dULL, 0x808e17555f3ebf11ULL, 0xe2bbd88bbee40bd0ULL,
+	0xa0b19d2ab70e6ed6ULL, 0x5b6aceaeae9d0ec4ULL, 0xc8de047564d20a8bULL, 0xf245825a5a445275ULL,
+	0xfb158592be068d2eULL, 0xeed6e2f0f0d56712ULL, 0x9ced737bb6c4183dULL, 0x55464dd69685606bULL,
+	0xc428d05aa4751e4cULL, 0xaa97e14c3c26b886ULL, 0xf53304714d9265dfULL, 0xd53dd99f4b3066a8ULL,
+	0x993fe2c6d07b7fabULL, 0xe546a8038efe4029ULL, 0xbf8fdb78849a5f96ULL, 0xde98520472bdd033ULL,
+	0xef73d256a5c0f77cULL, 0x963e66858f6d4440ULL, 0x95a8637627989aadULL, 0xdde7001379a44aa8ULL,
+	0xbb127c53b17ec159ULL, 0x5560c018580d5d52ULL, 0xe9d71b689dde71afULL, 0xaab8f01e6e10b4a6ULL,
+	0x9226712162ab070dULL, 0xcab3961304ca70e8ULL, 0xb6b00d69bb55c8d1ULL, 0x3d607b97c5fd0d22ULL,
+	0xe45c10c42a2b3b05ULL, 0x8cb89a7db77c506aULL, 0x8eb98a7a9a5b04e3ULL, 0x77f3608e92adb242ULL,
+	0xb267ed1940f1c61cULL, 0x55f038b237591ed3ULL, 0xdf01e85f912e37a3ULL, 0x6b6c46dec52f6688ULL,
+	0x8b61313bbabce2c6ULL, 0x2323ac4b3b3da015ULL, 0xae397d8aa96c1b77ULL, 0xabec975e0a0d081aULL,
+	0xd9c7dced53c72255ULL, 0x96e7bd358c904a21ULL, 0x881cea14545c7575ULL, 0x7e50d64177da2e54ULL,
+	0xaa242499697392d2ULL, 0xdde50bd1d5d0b9e9ULL, 0xd4ad2dbfc3d07787ULL, 0x955e4ec64b44e864ULL,
+	0x84ec3c97da624ab4ULL, 0xbd5af13bef0b113eULL, 0xa6274bbdd0fadd61ULL, 0xecb1ad8aeacdd58eULL,
+	0xcfb11ead453994baULL, 0x67de18eda5814af2ULL, 0x81ceb32c4b43fcf4ULL, 0x80eacf948770ced7ULL,
+	0xa2425ff75e14fc31ULL, 0xa1258379a94d028dULL, 0xcad2f7f5359a3b3eULL, 0x096ee45813a04330ULL,
+	0xfd87b5f28300ca0dULL, 0x8bca9d6e188853fcULL, 0x9e74d1b791e07e48ULL, 0x775ea264cf55347eULL,
+	0xc612062576589ddaULL, 0x95364afe032a819eULL, 0xf79687aed3eec551ULL, 0x3a83ddbd83f52205ULL,
+	0x9abe14cd44753b52ULL, 0xc4926a9672793543ULL, 0xc16d9a0095928a27ULL, 0x75b7053c0f178294ULL,
+	0xf1c90080baf72cb1ULL, 0x5324c68b12dd6339ULL, 0x971da05074da7beeULL, 0xd3f6fc16ebca5e04ULL,
+	0xbce5086492111aeaULL, 0x88f4bb1ca6bcf585ULL, 0xec1e4a7db69561a5ULL, 0x2b31e9e3d06c32e6ULL,
+	0x9392ee8e921d5d07ULL, 0x3aff322e62439fd0ULL, 0xb877aa3236a4b449ULL, 0x09befeb9fad487c3ULL,
+	0xe69594bec44de15bULL, 0x4c2ebe687989a9b4ULL, 0x901d7cf73ab0acd9ULL, 0x0f9d37014bf60a11ULL,
+	0xb424dc35095cd80fULL, 0x538484c19ef38c95ULL, 0xe12e13424bb40e13ULL, 0x2865a5f206b06fbaULL,
+	0x8cbccc096f5088cbULL, 0xf93f87b7442e45d4ULL, 0xafebff0bcb24aafeULL, 0xf78f69a51539d749ULL,
+	0xdbe6fecebdedd5beULL, 0xb573440e5a884d1cULL, 0x89705f4136b4a597ULL, 0x31680a88f8953031ULL,
+	0xabcc77118461cefcULL, 0xfdc20d2b36ba7c3eULL, 0xd6bf94d5e57a42bcULL, 0x3d32907604691b4dULL,
+	0x8637bd05af6c69b5ULL, 0xa63f9a49c2c1b110ULL, 0xa7c5ac471b478423ULL, 0x0fcf80dc33721d54ULL,
+	0xd1b71758e219652bULL, 0xd3c36113404ea4a9ULL, 0x83126e978d4fdf3bULL, 0x645a1cac083126eaULL,
+	0xa3d70a3d70a3d70aULL, 0x3d70a3d70a3d70a4ULL, 0xccccccccccccccccULL, 0xcccccccccccccccdULL,
+	0x8000000000000000ULL, 0x0000000000000000ULL, 0xa000000000000000ULL, 0x0000000000000000ULL,
+	0xc800000000000000ULL, 0x0000000000000000ULL, 0xfa00000000000000ULL, 0x0000000000000000ULL,
+	0x9c40000000000000ULL, 0x0000000000000000ULL, 0xc350000000000000ULL, 0x0000000000000000ULL,
+	0xf424000000000000ULL, 0x0000000000000000ULL, 0x9896800000000000ULL, 0x0000000000000000ULL,
+	0xbebc200000000000ULL, 0x0000000000000000ULL, 0xee6b280000000000ULL, 0x0000000000000000ULL,
+	0x9502f90000000000ULL, 0x0000000000000000ULL, 0xba43b74000000000ULL, 0x0000000000000000ULL,
+	0xe8d4a51000000000ULL, 0x0000000000000000ULL, 0x9184e72a00000000ULL, 0x0000000000000000ULL,
+	0xb5e620f480000000ULL, 0x0000000000000000ULL, 0xe35fa931a0000000ULL, 0x0000000000000000ULL,
+	0x8e1bc9bf04000000ULL, 0x0000000000000000ULL, 0xb1a2bc2ec5000000ULL, 0x0000000000000000ULL,
+	0xde0b6b3a76400000ULL, 0x0000000000000000ULL, 0x8ac7230489e80000ULL, 0x0000000000000000ULL,
+	0xad78ebc5ac620000ULL, 0x0000000000000000ULL, 0xd8d726b7177a8000ULL, 0x0000000000000000ULL,
+	0x878678326eac9000ULL, 0x0000000000000000ULL, 0xa968163f0a57b400ULL, 0x0000000000000000ULL,
+	0xd3c21bcecceda100ULL, 0x0000000000000000ULL, 0x84595161401484a0ULL, 0x0000000000000000ULL,
+	0xa56fa5b99019a5c8ULL, 0x0000000000000000ULL, 0xcecb8f27f4200f3aULL, 0x0000000000000000ULL,
+	0x813f3978f8940984ULL, 0x4000000000000000ULL, 0xa18f07d736b90be5ULL, 0x5000000000000000ULL,
+	0xc9f2c9cd04674edeULL, 0xa400000000000000ULL, 0xfc6f7c4045812296ULL, 0x4d00000000000000ULL,
+	0x9dc5ada82b70b59dULL, 0xf020000000000000ULL, 0xc5371912364ce305ULL, 0x6c28000000000000ULL,
+	0xf684df56c3e01bc6ULL, 0xc732000000000000ULL, 0x9a130b963a6c115cULL, 0x3c7f400000000000ULL,
+	0xc097ce7bc90715b3ULL, 0x4b9f100000000000ULL, 0xf0bdc21abb48db20ULL, 0x1e86d40000000000ULL,
+	0x96769950b50d88f4ULL, 0x1314448000000000ULL, 0xbc143fa4e250eb31ULL, 0x17d955a000000000ULL,
+	0xeb194f8e1ae525fdULL, 0x5dcfab0800000000ULL, 0x92efd1b8d0cf37beULL, 0x5aa1cae500000000ULL,
+	0xb7abc627050305adULL, 0xf14a3d9e40000000ULL, 0xe596b7b0c643c719ULL, 0x6d9ccd05d0000000ULL,
+	0x8f7e32ce7bea5c6fULL, 0xe4820023a2000000ULL, 0xb35dbf821ae4f38bULL, 0xdda2802c8a800000ULL,
+	0xe0352f62a19e306eULL, 0xd50b2037ad200000ULL, 0x8c213d9da502de45ULL, 0x4526f422cc340000ULL,
+	0xaf298d050e4395d6ULL, 0x9670b12b7f410000ULL, 0xdaf3f04651d47b4cULL, 0x3c0cdd765f114000ULL,
+	0x88d8762bf324cd0fULL, 0xa5880a69fb6ac800ULL, 0xab0e93b6efee0053ULL, 0x8eea0d047a457a00ULL,
+	0xd5d238a4abe98068ULL, 0x72a4904598d6d880ULL, 0x85a36366eb71f041ULL, 0x47a6da2b7f864750ULL,
+	0xa70c3c40a64e6c51ULL, 0x999090b65f67d924ULL, 0xd0cf4b50cfe20765ULL, 0xfff4b4e3f741cf6dULL,
+	0x82818f1281ed449fULL, 0xbff8f10e7a8921a4ULL, 0xa321f2d7226895c7ULL, 0xaff72d52192b6a0dULL,
+	0xcbea6f8ceb02bb39ULL, 0x9bf4f8a69f764490ULL, 0xfee50b7025c36a08ULL, 0x02f236d04753d5b4ULL,
+	0x9f4f2726179a2245ULL, 0x01d762422c946590ULL, 0xc722f0ef9d80aad6ULL, 0x424d3ad2b7b97ef5ULL,
+	0xf8ebad2b84e0d58bULL, 0xd2e0898765a7deb2ULL, 0x9b934c3b330c8577ULL, 0x63cc55f49f88eb2fULL,
+	0xc2781f49ffcfa6d5ULL, 0x3cbf6b71c76b25fbULL, 0xf316271c7fc3908aULL, 0x8bef464e3945ef7aULL,
+	0x97edd871cfda3a56ULL, 0x97758bf0e3cbb5acULL, 0xbde94e8e43d0c8ecULL, 0x3d52eeed1cbea317ULL,
+	0xed63a231d4c4fb27ULL, 0x4ca7aaa863ee4bddULL, 0x945e455f24fb1cf8ULL, 0x8fe8caa93e74ef6aULL,
+	0xb975d6b6ee39e436ULL, 0xb3e2fd538e122b44ULL, 0xe7d34c64a9c85d44ULL, 0x60dbbca87196b616ULL,
+	0x90e40fbeea1d3a4aULL, 0xbc8955e946fe31cdULL, 0xb51d13aea4a488ddULL, 0x6babab6398bdbe41ULL,
+	0xe264589a4dcdab14ULL, 0xc696963c7eed2dd1ULL, 0x8d7eb76070a08aecULL, 0xfc1e1de5cf543ca2ULL,
+	0xb0de65388cc8ada8ULL, 0x3b25a55f43294bcbULL, 0xdd15fe86affad912ULL, 0x49ef0eb713f39ebeULL,
+	0x8a2dbf142dfcc7abULL, 0x6e3569326c784337ULL, 0xacb92ed9397bf996ULL, 0x49c2c37f07965404ULL,
+	0xd7e77a8f87daf7fbULL, 0xdc33745ec97be906ULL, 0x86f0ac99b4e8dafdULL, 0x69a028bb3ded71a3ULL,
+	0xa8acd7c0222311bcULL, 0xc40832ea0d68ce0cULL, 0xd2d80db02aabd62bULL, 0xf50a3fa490c30190ULL,
+	0x83c7088e1aab65dbULL, 0x792667c6da79e0faULL, 0xa4b8cab1a1563f52ULL, 0x577001b891185938ULL,
+	0xcde6fd5e09abcf26ULL, 0xed4c0226b55e6f86ULL, 0x80b05e5ac60b6178ULL, 0x544f8158315b05b4ULL,
+	0xa0dc75f1778e39d6ULL, 0x696361ae3db1c721ULL, 0xc913936dd571c84cULL, 0x03bc3a19cd1e38e9ULL,
+	0xfb5878494ace3a5fULL, 0x04ab48a04065c723ULL, 0x9d174b2dcec0e47bULL, 0x62eb0d64283f9c76ULL,
+	0xc45d1df942711d9aULL, 0x3ba5d0bd324f8394ULL, 0xf5746577930d6500ULL, 0xca8f44ec7ee36479ULL,
+	0x9968bf6abbe85f20ULL, 0x7e998b13cf4e1ecbULL, 0xbfc2ef456ae276e8ULL, 0x9e3fedd8c321a67eULL,
+	0xefb3ab16c59b14a2ULL, 0xc5cfe94ef3ea101eULL, 0x95d04aee3b80ece5ULL, 0xbba1f1d158724a12ULL,
+	0xbb445da9ca61281fULL, 0x2a8a6e45ae8edc97ULL, 0xea1575143cf97226ULL, 0xf52d09d71a3293bdULL,
+	0x924d692ca61be758ULL, 0x593c2626705f9c56ULL, 0xb6e0c377cfa2e12eULL, 0x6f8b2fb00c77836cULL,
+	0xe498f455c38b997aULL, 0x0b6dfb9c0f956447ULL, 0x8edf98b59a373fecULL, 0x4724bd4189bd5eacULL,
+	0xb2977ee300c50fe7ULL, 0x58edec91ec2cb657ULL, 0xdf3d5e9bc0f653e1ULL, 0x2f2967b66737e3edULL,
+	0x8b865b215899f46cULL, 0xbd79e0d20082ee74ULL, 0xae67f1e9aec07187ULL, 0xecd8590680a3aa11ULL,
+	0xda01ee641a708de9ULL, 0xe80e6f4820cc9495ULL, 0x884134fe908658b2ULL, 0x3109058d147fdcddULL,
+	0xaa51823e34a7eedeULL, 0xbd4b46f0599fd415ULL, 0xd4e5e2cdc1d1ea96ULL, 0x6c9e18ac7007c91aULL,
+	0x850fadc09923329eULL, 0x03e2cf6bc604ddb0ULL, 0xa6539930bf6bff45ULL, 0x84db8346b786151cULL,
+	0xcfe87f7cef46ff16ULL, 0xe612641865679a63ULL, 0x81f14fae158c5f6eULL, 0x4fcb7e8f3f60c07eULL,
+	0xa26da3999aef7749ULL, 0xe3be5e330f38f09dULL, 0xcb090c8001ab551cULL, 0x5cadf5bfd3072cc5ULL,
+	0xfdcb4fa002162a63ULL, 0x73d9732fc7c8f7f6ULL, 0x9e9f11c4014dda7eULL, 0x2867e7fddcdd9afaULL,
+	0xc646d63501a1511dULL, 0xb281e1fd541501b8ULL, 0xf7d88bc24209a565ULL, 0x1f225a7ca91a4226ULL,
+	0x9ae757596946075fULL, 0x3375788de9b06958ULL, 0xc1a12d2fc3978937ULL, 0x0052d6b1641c83aeULL,
+	0xf209787bb47d6b84ULL, 0xc0678c5dbd23a49aULL, 0x9745eb4d50ce6332ULL, 0xf840b7ba963646e0ULL,
+	0xbd176620a501fbffULL, 0xb650e5a93bc3d898ULL, 0xec5d3fa8ce427affULL, 0xa3e51f138ab4cebeULL,
+	0x93ba47c980e98cdfULL, 0xc66f336c36b10137ULL, 0xb8a8d9bbe123f017ULL, 0xb80b0047445d4184ULL,
+	0xe6d3102ad96cec1dULL, 0xa60dc059157491e5ULL, 0x9043ea1ac7e41392ULL, 0x87c89837ad68db2fULL,
+	0xb454e4a179dd1877ULL, 0x29babe4598c311fbULL, 0xe16a1dc9d8545e94ULL, 0xf4296dd6fef3d67aULL,
+	0x8ce2529e2734bb1dULL, 0x1899e4a65f58660cULL, 0xb01ae745b101e9e4ULL, 0x5ec05dcff72e7f8fULL,
+	0xdc21a1171d42645dULL, 0x76707543f4fa1f73ULL, 0x899504ae72497ebaULL, 0x6a06494a791c53a8ULL,
+	0xabfa45da0edbde69ULL, 0x0487db9d17636892ULL, 0xd6f8d7509292d603ULL, 0x45a9d2845d3c42b6ULL,
+	0x865b86925b9bc5c2ULL, 0x0b8a2392ba45a9b2ULL, 0xa7f26836f282b732ULL, 0x8e6cac7768d7141eULL,
+	0xd1ef0244af2364ffULL, 0x3207d795430cd926ULL, 0x8335616aed761f1fULL, 0x7f44e6bd49e807b8ULL,
+	0xa402b9c5a8d3a6e7ULL, 0x5f16206c9c6209a6ULL, 0xcd036837130890a1ULL, 0x36dba887c37a8c0fULL,
+	0x802221226be55a64ULL, 0xc2494954da2c9789ULL, 0xa02aa96b06deb0fdULL, 0xf2db9baa10b7bd6cULL,
+	0xc83553c5c8965d3dULL, 0x6f92829494e5acc7ULL, 0xfa42a8b73abbf48cULL, 0xcb772339ba1f17f9ULL,
+	0x9c69a97284b578d7ULL, 0xff2a760414536efbULL, 0xc38413cf25e2d70dULL, 0xfef5138519684abaULL,
+	0xf46518c2ef5b8cd1ULL, 0x7eb258665fc25d69ULL, 0x98bf2f79d5993802ULL, 0xef2f773ffbd97a61ULL,
+	0xbeeefb584aff8603ULL, 0xaafb550ffacfd8faULL, 0xeeaaba2e5dbf6784ULL, 0x95ba2a53f983cf38ULL,
+	0x952ab45cfa97a0b2ULL, 0xdd945a747bf26183ULL, 0xba756174393d88dfULL, 0x94f971119aeef9e4ULL,
+	0xe912b9d1478ceb17ULL, 0x7a37cd5601aab85dULL, 0x91abb422ccb812eeULL, 0xac62e055c10ab33aULL,
+	0xb616a12b7fe617aaULL, 0x577b986b314d6009ULL, 0xe39c49765fdf9d94ULL, 0xed5a7e85fda0b80bULL,
+	0x8e41ade9fbebc27dULL, 0x14588f13be847307ULL, 0xb1d219647ae6b31cULL, 0x596eb2d8ae258fc8ULL,
+	0xde469fbd99a05fe3ULL, 0x6fca5f8ed9aef3bbULL, 0x8aec23d680043beeULL, 0x25de7bb9480d5854ULL,
+	0xada72ccc20054ae9ULL, 0xaf561aa79a10ae6aULL, 0xd910f7ff28069da4ULL, 0x1b2ba1518094da04ULL,
+	0x87aa9aff79042286ULL, 0x90fb44d2f05d0842ULL, 0xa99541bf57452b28ULL, 0x353a1607ac744a53ULL,
+	0xd3fa922f2d1675f2ULL, 0x42889b8997915ce8ULL, 0x847c9b5d7c2e09b7ULL, 0x69956135febada11ULL,
+	0xa59bc234db398c25ULL, 0x43fab9837e699095ULL, 0xcf02b2c21207ef2eULL, 0x94f967e45e03f4bbULL,
+	0x8161afb94b44f57dULL, 0x1d1be0eebac278f5ULL, 0xa1ba1ba79e1632dcULL, 0x6462d92a69731732ULL,
+	0xca28a291859bbf93ULL, 0x7d7b8f7503cfdcfeULL, 0xfcb2cb35e702af78ULL, 0x5cda735244c3d43eULL,
+	0x9defbf01b061adabULL, 0x3a0888136afa64a7ULL, 0xc56baec21c7a1916ULL, 0x088aaa1845b8fdd0ULL,
+	0xf6c69a72a3989f5bULL, 0x8aad549e57273d45ULL, 0x9a3c2087a63f6399ULL, 0x36ac54e2f678864bULL,
+	0xc0cb28a98fcf3c7fULL, 0x84576a1bb416a7ddULL, 0xf0fdf2d3f3c30b9fULL, 0x656d44a2a11c51d5ULL,
+	0x969eb7c47859e743ULL, 0x9f644ae5a4b1b325ULL, 0xbc4665b596706114ULL, 0x873d5d9f0dde1feeULL,
+	0xeb57ff22fc0c7959ULL, 0xa90cb506d155a7eaULL, 0x9316ff75dd87cbd8ULL, 0x09a7f12442d588f2ULL,
+	0xb7dcbf5354e9beceULL, 0x0c11ed6d538aeb2fULL, 0xe5d3ef282a242e81ULL, 0x8f1668c8a86da5faULL,
+	0x8fa475791a569d10ULL, 0xf96e017d694487bcULL, 0xb38d92d760ec4455ULL, 0x37c981dcc395a9acULL,
+	0xe070f78d3927556aULL, 0x85bbe253f47b1417ULL, 0x8c469ab843b89562ULL, 0x93956d7478ccec8eULL,
+	0xaf58416654a6babbULL, 0x387ac8d1970027b2ULL, 0xdb2e51bfe9d0696aULL, 0x06997b05fcc0319eULL,
+	0x88fcf317f22241e2ULL, 0x441fece3bdf81f03ULL, 0xab3c2fddeeaad25aULL, 0xd527e81cad7626c3ULL,
+	0xd60b3bd56a5586f1ULL, 0x8a71e223d8d3b074ULL, 0x85c7056562757456ULL, 0xf6872d5667844e49ULL,
+	0xa738c6bebb12d16cULL, 0xb428f8ac016561dbULL, 0xd106f86e69d785c7ULL, 0xe13336d701beba52ULL,
+	0x82a45b450226b39cULL, 0xecc0024661173473ULL, 0xa34d721642b06084ULL, 0x27f002d7f95d0190ULL,
+	0xcc20ce9bd35c78a5ULL, 0x31ec038df7b441f4ULL, 0xff290242c83396ceULL, 0x7e67047175a15271ULL,
+	0x9f79a169bd203e41ULL, 0x0f0062c6e984d386ULL, 0xc75809c42c684dd1ULL, 0x52c07b78a3e60868ULL,
+	0xf92e0c3537826145ULL, 0xa7709a56ccdf8a82ULL, 0x9bbcc7a142b17ccbULL, 0x88a66076400bb691ULL,
+	0xc2abf989935ddbfeULL, 0x6acff893d00ea435ULL, 0xf356f7ebf83552feULL, 0x0583f6b8c4124d43ULL,
+	0x98165af37b2153deULL, 0xc3727a337a8b704aULL, 0xbe1bf1b059e9a8d6ULL, 0x744f18c0592e4c5cULL,
+	0xeda2ee1c7064130cULL, 0x1162def06f79df73ULL, 0x9485d4d1c63e8be7ULL, 0x8addcb5645ac2ba8ULL,
+	0xb9a74a0637ce2ee1ULL, 0x6d953e2bd7173692ULL, 0xe8111c87c5c1ba99ULL, 0xc8fa8db6ccdd0437ULL,
+	0x910ab1d4db9914a0ULL, 0x1d9c9892400a22a2ULL, 0xb54d5e4a127f59c8ULL, 0x2503beb6d00cab4bULL,
+	0xe2a0b5dc971f303aULL, 0x2e44ae64840fd61dULL, 0x8da471a9de737e24ULL, 0x5ceaecfed289e5d2ULL,
+	0xb10d8e1456105dadULL, 0x7425a83e872c5f47ULL, 0xdd50f1996b947518ULL, 0xd12f124e28f77719ULL,
+	0x8a5296ffe33cc92fULL, 0x82bd6b70d99aaa6fULL, 0xace73cbfdc0bfb7bULL, 0x636cc64d1001550bULL,
+	0xd8210befd30efa5aULL, 0x3c47f7e05401aa4eULL, 0x8714a775e3e95c78ULL, 0x65acfaec34810a71ULL,
+	0xa8d9d1535ce3b396ULL, 0x7f1839a741a14d0dULL, 0xd31045a8341ca07cULL, 0x1ede48111209a050ULL,
+	0x83ea2b892091e44dULL, 0x934aed0aab460432ULL, 0xa4e4b66b68b65d60ULL, 0xf81da84d5617853fULL,
+	0xce1de40642e3f4b9ULL, 0x36251260ab9d668eULL, 0x80d2ae83e9ce78f3ULL, 0xc1d72b7c6b426019ULL,
+	0xa1075a24e4421730ULL, 0xb24cf65b8612f81fULL, 0xc94930ae1d529cfcULL, 0xdee033f26797b627ULL,
+	0xfb9b7cd9a4a7443cULL, 0x169840ef017da3b1ULL, 0x9d412e0806e88aa5ULL, 0x8e1f289560ee864eULL,
+	0xc491798a08a2ad4eULL, 0xf1a6f2bab92a27e2ULL, 0xf5b5d7ec8acb58a2ULL, 0xae10af696774b1dbULL,
+	0x9991a6f3d6bf1765ULL, 0xacca6da1e0a8ef29ULL, 0xbff610b0cc6edd3fULL, 0x17fd090a58d32af3ULL,
+	0xeff394dcff8a948eULL, 0xddfc4b4cef07f5b0ULL, 0x95f83d0a1fb69cd9ULL, 0x4abdaf101564f98eULL,
+	0xbb764c4ca7a4440fULL, 0x9d6d1ad41abe37f1ULL, 0xea53df5fd18d5513ULL, 0x84c86189216dc5edULL,
+	0x92746b9be2f8552cULL, 0x32fd3cf5b4e49bb4ULL, 0xb7118682dbb66a77ULL, 0x3fbc8c33221dc2a1ULL,
+	0xe4d5e82392a40515ULL, 0x0fabaf3feaa5334aULL, 0x8f05b1163ba6832dULL, 0x29cb4d87f2a7400eULL,
+	0xb2c71d5bca9023f8ULL, 0x743e20e9ef511012ULL, 0xdf78e4b2bd342cf6ULL, 0x914da9246b255416ULL,
+	0x8bab8eefb6409c1aULL, 0x1ad089b6c2f7548eULL, 0xae9672aba3d0c320ULL, 0xa184ac2473b529b1ULL,
+	0xda3c0f568cc4f3e8ULL, 0xc9e5d72d90a2741eULL, 0x8865899617fb1871ULL, 0x7e2fa67c7a658892ULL,
+	0xaa7eebfb9df9de8dULL, 0xddbb901b98feeab7ULL, 0xd51ea6fa85785631ULL, 0x552a74227f3ea565ULL,
+	0x8533285c936b35deULL, 0xd53a88958f87275fULL, 0xa67ff273b8460356ULL, 0x8a892abaf368f137ULL,
+	0xd01fef10a657842cULL, 0x2d2b7569b0432d85ULL, 0x8213f56a67f6b29bULL, 0x9c3b29620e29fc73ULL,
+	0xa298f2c501f45f42ULL, 0x8349f3ba91b47b8fULL, 0xcb3f2f7642717713ULL, 0x241c70a936219a73ULL,
+	0xfe0efb53d30dd4d7ULL, 0xed238cd383aa0110ULL, 0x9ec95d1463e8a506ULL, 0xf4363804324a40aaULL,
+	0xc67bb4597ce2ce48ULL, 0xb143c6053edcd0d5ULL, 0xf81aa16fdc1b81daULL, 0xdd94b7868e94050aULL,
+	0x9b10a4e5e9913128ULL, 0xca7cf2b4191c8326ULL, 0xc1d4ce1f63f57d72ULL, 0xfd1c2f611f63a3f0ULL,
+	0xf24a01a73cf2dccfULL, 0xbc633b39673c8cecULL, 0x976e41088617ca01ULL, 0xd5be0503e085d813ULL,
+	0xbd49d14aa79dbc82ULL, 0x4b2d8644d8a74e18ULL, 0xec9c459d51852ba2ULL, 0xddf8e7d60ed1219eULL,
+	0x93e1ab8252f33b45ULL, 0xcabb90e5c942b503ULL, 0xb8da1662e7b00a17ULL, 0x3d6a751f3b936243ULL,
+	0xe7109bfba19c0c9dULL, 0x0cc512670a783ad4ULL, 0x906a617d450187e2ULL, 0x27fb2b80668b24c5ULL,
+	0xb484f9dc9641e9daULL, 0xb1f9f660802dedf6ULL, 0xe1a63853bbd26451ULL, 0x5e7873f8a0396973ULL,
+	0x8d07e33455637eb2ULL, 0xdb0b487b6423e1e8ULL, 0xb049dc016abc5e5fULL, 0x91ce1a9a3d2cda62ULL,
+	0xdc5c5301c56b75f7ULL, 0x7641a140cc7810fbULL, 0x89b9b3e11b6329baULL, 0xa9e904c87fcb0a9dULL,
+	0xac2820d9623bf429ULL, 0x546345fa9fbdcd44ULL, 0xd732290fbacaf133ULL, 0xa97c177947ad4095ULL,
+	0x867f59a9d4bed6c0ULL, 0x49ed8eabcccc485dULL, 0xa81f301449ee8c70ULL, 0x5c68f256bfff5a74ULL,
+	0xd226fc195c6a2f8cULL, 0x73832eec6fff3111ULL, 0x83585d8fd9c25db7ULL, 0xc831fd53c5ff7eabULL,
+	0xa42e74f3d032f525ULL, 0xba3e7ca8b77f5e55ULL, 0xcd3a1230c43fb26fULL, 0x28ce1bd2e55f35ebULL,
+	0x80444b5e7aa7cf85ULL, 0x7980d163cf5b81b3ULL, 0xa0555e361951c366ULL, 0xd7e105bcc332621fULL,
+	0xc86ab5c39fa63440ULL, 0x8dd9472bf3fefaa7ULL, 0xfa856334878fc150ULL, 0xb14f98f6f0feb951ULL,
+	0x9c935e00d4b9d8d2ULL, 0x6ed1bf9a569f33d3ULL, 0xc3b8358109e84f07ULL, 0x0a862f80ec4700c8ULL,
+	0xf4a642e14c6262c8ULL, 0xcd27bb612758c0faULL, 0x98e7e9cccfbd7dbdULL, 0x8038d51cb897789cULL,
+	0xbf21e44003acdd2cULL, 0xe0470a63e6bd56c3ULL, 0xeeea5d5004981478ULL, 0x1858ccfce06cac74ULL,
+	0x95527a5202df0ccbULL, 0x0f37801e0c43ebc8ULL, 0xbaa718e68396cffdULL, 0xd30560258f54e6baULL,
+	0xe950df20247c83fdULL, 0x47c6b82ef32a2069ULL, 0x91d28b7416cdd27eULL, 0x4cdc331d57fa5441ULL,
+	0xb6472e511c81471dULL, 0xe0133fe4adf8e952ULL, 0xe3d8f9e563a198e5ULL, 0x58180fddd97723a6ULL,
+	0x8e679c2f5e44ff8fULL, 0x570f09eaa7ea7648ULL,
+};
 
-/* parser rules */
+// exactly representable powers of ten
+static const double exact_pow10[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
 
-typedef struct {
-	char* key;
-	json_value_t* value;
-} _pair_t;
-
-static bool parse_value(aojls_ctx_t*, tokenizer_t*, json_value_t**);
-static bool parse_object(aojls_ctx_t*, tokenizer_t*, json_object**);
-static bool parse_members(aojls_ctx_t*, tokenizer_t*, _pair_t**, size_t*);
-static bool parse_pair(aojls_ctx_t*, tokenizer_t*, _pair_t*);
-static bool parse_array(aojls_ctx_t*, tokenizer_t*, json_array**);
-static bool parse_elements(aojls_ctx_t*, tokenizer_t*, json_value_t***, size_t*);
-static bool parse_string(aojls_ctx_t*, tokenizer_t*, char**);
-static bool parse_number(aojls_ctx_t*, tokenizer_t*, double*);
-static bool parse_int(aojls_ctx_t*, tokenizer_t*, double*);
-static bool parse_fract(aojls_ctx_t*, tokenizer_t*, double*);
-static bool parse_exp(aojls_ctx_t*, tokenizer_t*, double*);
-static bool parse_digits(aojls_ctx_t*, tokenizer_t*, char**);
-static bool parse_digit(aojls_ctx_t*, tokenizer_t*, char*);
-static bool parse_digit19(aojls_ctx_t*, tokenizer_t*, char*);
-
-static bool parse_value(aojls_ctx_t* ctx, tokenizer_t* tokenizer, json_value_t** result) {
-	size_t cprg = get_current_pos(tokenizer);
-	char* str;
-	if (parse_string(ctx, tokenizer, &str)) {
-		json_string* s = json_from_string(ctx, str);
-		if (s == NULL)
-			fail(tokenizer, FAIL_ENOMEM);
-		*result = (json_value_t*)s;
+// significant digits that fit into uint64_t
+#define MANTISSA_DIGITS 19
+// digits that decide rounding of any double, more are only sticky
+#define DECIMAL_DIGITS 768
+
+static inline void mul_64x64(uint64_t a, uint64_t b, uint64_t* hi, uint64_t* lo) {
+#ifdef __SIZEOF_INT128__
+	__extension__ unsigned __int128 r = (unsigned __int128)a * b;
+	*hi = (uint64_t)(r >> 64);
+	*lo = (uint64_t)r;
+#else
+	uint64_t al = a & 0xFFFFFFFF, ah = a >> 32;
+	uint64_t bl = b & 0xFFFFFFFF, bh = b >> 32;
+	uint64_t ll = al*bl, lh = al*bh, hl = ah*bl, hh = ah*bh;
+	uint64_t mid = (ll >> 32) + (lh & 0xFFFFFFFF) + (hl & 0xFFFFFFFF);
+	*lo = (mid << 32) | (ll & 0xFFFFFFFF);
+	*hi = hh + (lh >> 32) + (hl >> 32) + (mid >> 32);
+#endif
+}
+
+static inline int leading_zeros(uint64_t x) {
+#ifdef __GNUC__
+	return __builtin_clzll(x);
+#else
+	int n = 0;
+	while (!(x & 0x8000000000000000ULL)) {
+		x <<= 1;
+		++n;
+	}
+	return n;
+#endif
+}
+
+// Eisel-Lemire, computes bits of w * 10^q (w != 0) or returns false if they can not be decided
+static bool eisel_lemire(uint64_t w, long q, uint64_t* bits) {
+	if (q < POW5_MIN) {
+		*bits = 0;
 		return true;
 	}
-	set_current_pos(tokenizer, cprg);
-	double res = 0;
-	if (parse_number(ctx, tokenizer, &res)) {
-		json_number* num = json_from_number(ctx, res);
-		if (num == NULL)
-			fail(tokenizer, FAIL_ENOMEM);
-		*result = (json_value_t*)num;
+	if (q > POW5_MAX) {
+		*bits = 0x7FF0000000000000ULL;
 		return true;
 	}
-	set_current_pos(tokenizer, cprg);
-	if (parse_object(ctx, tokenizer, (json_object**)result)) {
-		return true;
+
+	int lz = leading_zeros(w);
+	w <<= lz;
+
+	// enough of the product to get 55 bits right
+	const uint64_t* p5 = &pow5_128[2*(q - POW5_MIN)];
+	uint64_t hi, lo;
+	mul_64x64(w, p5[0], &hi, &lo);
+	if ((hi & 0x1FF) == 0x1FF) {
+		uint64_t hi2, lo2;
+		mul_64x64(w, p5[1], &hi2, &lo2);
+		lo += hi2;
+		if (hi2 > lo)
+			++hi;
+		if (lo == 0xFFFFFFFFFFFFFFFFULL && (q < -27 || q > 55))
+			return false;
 	}
-	set_current_pos(tokenizer, cprg);
-	if (parse_array(ctx, tokenizer, (json_array**)result)) {
+
+	int upperbit = (int)(hi >> 63);
+	int shift = upperbit + 9;
+	uint64_t mantissa = hi >> shift;
+	// floor(log2(10^q)) + 63 is (152170 + 65536)*q >> 16 + 63
+	long power2 = ((((152170L + 65536L) * q) >> 16) + 63) + upperbit - lz + 1023;
+
+	if (power2 <= 0) {
+		// subnormal
+		if (-power2 + 1 >= 64) {
+			*bits = 0;
+			return true;
+		}
+		mantissa >>= -power2 + 1;
+		mantissa += mantissa & 1;
+		mantissa >>= 1;
+		power2 = mantissa < (1ULL << 52) ? 0 : 1;
+		*bits = mantissa | ((uint64_t)power2 << 52);
 		return true;
 	}
-	if (next_type(tokenizer, _TRUE)) {
-		next(tokenizer); // eat token
-		json_boolean* b = json_from_boolean(ctx, 1);
-		if (b == NULL)
-			fail(tokenizer, FAIL_ENOMEM);
-		*result = (json_value_t*)b;
-		return true;
+
+	// exactly halfway between two doubles rounds to even
+	if (lo <= 1 && q >= -4 && q <= 23 && (mantissa & 3) == 1) {
+		if ((mantissa << shift) == hi)
+			mantissa &= ~1ULL;
 	}
-	if (next_type(tokenizer, _FALSE)) {
-		next(tokenizer); // eat token
-		json_boolean* b = json_from_boolean(ctx, 0);
-		if (b == NULL)
-			fail(tokenizer, FAIL_ENOMEM);
-		*result = (json_value_t*)b;
-		return true;
+	mantissa += mantissa & 1;
+	mantissa >>= 1;
+	if (mantissa >= (2ULL << 52)) {
+		mantissa = 1ULL << 52;
+		++power2;
 	}
-	if (next_type(tokenizer, _NULL)) {
-		next(tokenizer); // eat token
-		json_null* n = json_make_null(ctx);
-		if (n == NULL)
-			fail(tokenizer, FAIL_ENOMEM);
-		*result = (json_value_t*)n;
+	mantissa &= ~(1ULL << 52);
+	if (power2 >= 0x7FF) {
+		*bits = 0x7FF0000000000000ULL;
 		return true;
 	}
-	*result = NULL;
-	return false;
+	*bits = mantissa | ((uint64_t)power2 << 52);
+	return true;
 }
 
-static bool parse_object(aojls_ctx_t* ctx, tokenizer_t* tokenizer, json_object** object) {
-	_pair_t* pairs;
-	size_t len;
-
-	if (next_type(tokenizer, LEFT_CURLY)) {
-		next(tokenizer);
-		if (next_type(tokenizer, RIGHT_CURLY)) {
-			next(tokenizer);
-			*object = json_make_object(ctx);
-			if ((*object) == NULL)
-				fail(tokenizer, FAIL_ENOMEM);
-			return true;
-		} else if (parse_members(ctx, tokenizer, &pairs, &len)) {
-			if (!next_type(tokenizer, RIGHT_CURLY)) {
-				free(pairs);
-				fail(tokenizer, FAIL_EXPECTED_EOO);
-			}
-
-			*object = json_make_object(ctx);
-			if ((*object) == NULL) {
-				free(pairs);
-				fail(tokenizer, FAIL_ENOMEM);
-			}
-			for (size_t i=0; i<len; i++) {
-				_pair_t* p = &pairs[i];
-				if (json_object_add(*object, p->key, p->value) == NULL) {
-					free(pairs);
-					fail(tokenizer, FAIL_ENOMEM);
-				}
-			}
-			free(pairs);
-			next(tokenizer);
-			return true;
+static double digits_to_double(const char* s, size_t len, int flags) {
+	// slow path, digits are rewritten without decimal point, so strtod does not depend on locale
+	char buffer[DECIMAL_DIGITS + 32];
+	size_t k = 0;
+	size_t i = 0;
+	long scale = 0;
+	bool sticky = false;
+	bool fraction = false;
+
+	if (flags & NUMBER_MINUS)
+		buffer[k++] = s[i++];
+	size_t first = k;
+	for (; i < len && (is_digit(s[i]) || s[i] == '.'); i++) {
+		if (s[i] == '.') {
+			fraction = true;
+		} else if (k == first && s[i] == '0') {
+			// leading zero
+			if (fraction)
+				--scale;
+		} else if (k - first < DECIMAL_DIGITS) {
+			buffer[k++] = s[i];
+			if (fraction)
+				--scale;
+		} else {
+			sticky |= s[i] != '0';
+			if (!fraction)
+				++scale;
 		}
 	}
-	return false;
-}
+	if (sticky) {
+		// any digit past the last one that matters only breaks the tie
+		buffer[k++] = '1';
+		--scale;
+	}
 
-static bool parse_members(aojls_ctx_t* ctx, tokenizer_t* tokenizer, _pair_t** members, size_t* members_count) {
-	size_t bfc = 16;
-	size_t len = 0;
-	_pair_t* memb = (_pair_t*)malloc(sizeof(_pair_t)*bfc);
-	bool first = true;
-
-	do {
-		int cpgr = get_current_pos(tokenizer);
-		if (!first)
-			next(tokenizer); // eat comma
-		_pair_t pair;
-		if (!parse_pair(ctx, tokenizer, &pair)) {
-			if (!first) {
-				free(memb);
-				fail(tokenizer, FAIL_EXPECTED_PAIR);
-			}
-			set_current_pos(tokenizer, cpgr);
-			break;
+	if (flags & NUMBER_EXPONENT) {
+		bool minus = false;
+		long exp = 0;
+		++i; // e/E
+		if (s[i] == '+') {
+			++i;
+		} else if (s[i] == '-') {
+			minus = true;
+			++i;
 		}
-
-		if (len == bfc) {
-			size_t nbfc = bfc * 2;
-			_pair_t* nmemb = (_pair_t*)realloc(memb, sizeof(_pair_t)*nbfc);
-			if (nmemb == NULL) {
-				free(memb);
-				fail(tokenizer, FAIL_ENOMEM);
-			}
-			memb = nmemb;
-			bfc = nbfc;
+		for (; i < len; i++) {
+			if (exp < 100000)
+				exp = exp*10 + (s[i] - '0');
 		}
-		memb[len++] = pair;
-
-		first = false;
-	} while (next_type(tokenizer, COMMA));
+		scale += minus ? -exp : exp;
+	}
 
-	*members = memb;
-	*members_count = len;
-	return true;
+	k += sprintf(buffer + k, "e%ld", scale);
+	return strtod(buffer, NULL);
 }
 
-static bool parse_pair(aojls_ctx_t* ctx, tokenizer_t* tokenizer, _pair_t* pair) {
-	char* str;
-	_pair_t pp;
+// converts validated number span with correct rounding
+static double span_to_double(const char* s, size_t len, int flags) {
+	size_t i = (flags & NUMBER_MINUS) ? 1 : 0;
+	uint64_t w = 0;
+	int digits = 0;
+	long scale = 0;
+	bool truncated = false;
 
-	if (!parse_string(ctx, tokenizer, &str)) {
-		return false;
-	}
-	pp.key = str;
-	if (!next_type(tokenizer, COLON)) {
-		return false;
-	}
-	next(tokenizer); // eat colon
-	if (!parse_value(ctx, tokenizer, &pp.value)) {
-		return false;
+	for (; i < len && is_digit(s[i]); i++) {
+		if (digits < MANTISSA_DIGITS) {
+			w = w*10 + (s[i] - '0');
+			if (w != 0)
+				++digits;
+		} else {
+			truncated |= s[i] != '0';
+			++scale;
+		}
 	}
-	*pair = pp;
-	return true;
-}
-
-static bool parse_array(aojls_ctx_t* ctx, tokenizer_t* tokenizer, json_array** array) {
-	json_value_t** elements;
-	size_t len;
 
-	if (next_type(tokenizer, LEFT_SQUARE)) {
-		next(tokenizer);
-		if (next_type(tokenizer, RIGHT_SQUARE)) {
-			next(tokenizer);
-			*array = json_make_array(ctx);
-			if ((*array) == NULL)
-				fail(tokenizer, FAIL_ENOMEM);
-			return true;
-		} else if (parse_elements(ctx, tokenizer, &elements, &len)) {
-			if (!next_type(tokenizer, RIGHT_SQUARE)) {
-				free(elements);
-				fail(tokenizer, FAIL_EXPECTED_EOL);
-			}
-			next(tokenizer);
+	if (flags & NUMBER_FRACTION) {
+		for (++i; i < len && is_digit(s[i]); i++) {
+			if (digits < MANTISSA_DIGITS) {
+				w = w*10 + (s[i] - '0');
+				if (w != 0)
+					++digits;
+				--scale;
+			} else
+				truncated |= s[i] != '0';
+		}
+	}
 
-			*array = json_make_array(ctx);
-			if ((*array) == NULL) {
-				free(elements);
-				fail(tokenizer, FAIL_ENOMEM);
-			}
-			for (size_t i=0; i<len; i++) {
-				json_value_t* v = elements[i];
-				if (json_array_add(*array, v) == NULL) {
-					free(elements);
-					fail(tokenizer, FAIL_ENOMEM);
-				}
-			}
-			free(elements);
-			return true;
+	if (flags & NUMBER_EXPONENT) {
+		bool minus = false;
+		long exp = 0;
+		++i; // e/E
+		if (s[i] == '+') {
+			++i;
+		} else if (s[i] == '-') {
+			minus = true;
+			++i;
 		}
+		for (; i < len; i++) {
+			if (exp < 100000)
+				exp = exp*10 + (s[i] - '0');
+		}
+		scale += minus ? -exp : exp;
 	}
-	return false;
-}
 
-static bool parse_elements(aojls_ctx_t* ctx, tokenizer_t* tokenizer, json_value_t*** elements, size_t* size) {
-	size_t bfc = 16;
-	size_t len = 0;
-	json_value_t** elems = (json_value_t**)malloc(sizeof(json_value_t*)*bfc);
-	bool first = true;
-
-	do {
-		int cpgr = get_current_pos(tokenizer);
-		if (!first)
-			next(tokenizer); // eat comma
-		json_value_t* value;
-		if (!parse_value(ctx, tokenizer, &value)) {
-			if (!first) {
-				free(elems);
-				fail(tokenizer, FAIL_EXPECTED_VALUE);
+	double r;
+	if (w == 0) {
+		r = 0;
+	} else if (!truncated && w <= (1ULL << 53) && scale >= -22 && scale <= 22) {
+		// Clinger, both operands are exact so single operation rounds correctly
+		r = (double)w;
+		if (scale < 0)
+			r /= exact_pow10[-scale];
+		else
+			r *= exact_pow10[scale];
+	} else {
+		uint64_t bits, upper;
+		if (!eisel_lemire(w, scale, &bits)
+				|| (truncated && (!eisel_lemire(w + 1, scale, &upper) || upper != bits)))
+			return digits_to_double(s, len, flags);
+		memcpy(&r, &bits, sizeof(double));
+	}
+	return (flags & NUMBER_MINUS) ? -r : r;
+}
+
+// integers that fit 64 bits keep exact value, everything else is converted to double
+static void span_to_number(const char* s, size_t len, int flags, _aojls_slot_t* slot) {
+	slot->self.type = JS_NUMBER;
+	if (!(flags & (NUMBER_FRACTION | NUMBER_EXPONENT))) {
+		bool minus = (flags & NUMBER_MINUS) != 0;
+		size_t i = minus ? 1 : 0;
+		uint64_t v = 0;
+		if (len - i <= 20) {
+			for (; i < len; i++) {
+				unsigned d = (unsigned)(s[i] - '0');
+				if (v > (UINT64_MAX - d) / 10)
+					break;
+				v = v*10 + d;
 			}
-			set_current_pos(tokenizer, cpgr);
-			break;
 		}
-
-		if (len == bfc) {
-			size_t nbfc = bfc * 2;
-			json_value_t** nelems = (json_value_t**)realloc(elems, sizeof(json_value_t*)*nbfc);
-			if (nelems == NULL) {
-				free(elems);
-				fail(tokenizer, FAIL_ENOMEM);
+		if (i == len) {
+			if (!minus && v > INT64_MAX) {
+				slot->kind = NUM_UINT64;
+				slot->as.uint64 = v;
+				return;
+			} else if (!minus) {
+				slot->kind = NUM_INT64;
+				slot->as.int64 = (int64_t)v;
+				return;
+			} else if (v != 0 && v <= (uint64_t)INT64_MAX + 1) {
+				// -0 stays double to keep its sign
+				slot->kind = NUM_INT64;
+				slot->as.int64 = -(int64_t)(v - 1) - 1;
+				return;
 			}
-			elems = nelems;
-			bfc = nbfc;
 		}
-		elems[len++] = value;
-
-		first = false;
-	} while (next_type(tokenizer, COMMA));
-
-	*elements = elems;
-	*size = len;
-	return true;
+	}
+	slot->kind = NUM_DOUBLE;
+	slot->as.number = span_to_double(s, len, flags);
 }
 
-static bool parse_string(aojls_ctx_t* ctx, tokenizer_t* tokenizer, char** string) {
-	if (next_type(tokenizer, STRING)) {
-		json_token_t* token = next(tokenizer);
-		*string = append_string(ctx, token->value, token->len);
-		return true;
+static void raw_to_number(const char* raw, _aojls_slot_t* slot) {
+	int flags = raw[0] == '-' ? NUMBER_MINUS : 0;
+	size_t len = 0;
+	for (; raw[len] != '\0'; len++) {
+		if (raw[len] == '.')
+			flags |= NUMBER_FRACTION;
+		else if (raw[len] == 'e' || raw[len] == 'E')
+			flags |= NUMBER_EXPONENT;
 	}
-	return false;
+	span_to_number(raw, len, flags, slot);
 }
 
-static size_t count_digits(double d) {
-	if (d == 0.0)
-		return 0;
-	char buffer[MAX_DOUBLE_LENGTH];
-	sprintf(buffer, "%.0f", d);
-	size_t len = strlen(buffer);
-	return d < 0 ? len-1 : len;
-}
-
-static inline double power(double x, long y) {
-	double temp;
-    if (y == 0)
-       return 1;
-    temp = power(x, y/2);
-    if (y%2 == 0)
-        return temp*temp;
-    else {
-        if(y > 0)
-            return x*temp*temp;
-        else
-            return (temp*temp)/x;
-    }
-}
-
-static bool parse_number(aojls_ctx_t* ctx, tokenizer_t* tokenizer, double* num) {
-	double _int;
-	double _frac;
-	double _exp;
-	double r;
-
-	if (!parse_int(ctx, tokenizer, &_int)) {
-		return false;
-	}
+/* parser */
 
-	size_t cpgr = get_current_pos(tokenizer);
-	if (parse_fract(ctx, tokenizer, &_frac)) {
-		size_t cpgr2 = get_current_pos(tokenizer);
-		if (parse_exp(ctx, tokenizer, &_exp)) {
-			goto compute_number;
-		} else {
-			set_current_pos(tokenizer, cpgr2);
-			_exp = 0;
-			goto compute_number;
-		}
-	}
-	set_current_pos(tokenizer, cpgr);
-	_frac = 0;
+typedef struct {
+	json_type_t type; // JS_OBJECT or JS_ARRAY
+	size_t start; // first staged child of this container
+	char* key; // key of the member being parsed
+	bool empty; // no child parsed yet
+	size_t span; // index of the container in the document, if indexing
+} _frame_t;
+
+static json_string* token_string(aojls_ctx_t* ctx, json_token_t* token) {
+	// token data lives in scratch or source, it is copied unless it is borrowed
+	if (token->flags & STRING_INSITU)
+		return make_insitu_string(ctx, token->value, token->len);
+	else if (token->flags & STRING_BORROWED)
+		return make_borrowed_string(ctx, token->value, token->len, (token->flags & STRING_ESCAPED) != 0);
+	else
+		return make_string(ctx, token->value, token->len);
+}
+
+static char* token_key(aojls_ctx_t* ctx, json_token_t* token) {
+	// token text is only valid until more tokens are lexed, keys are never borrowed
+	if (token->flags & STRING_INSITU) {
+		// key stays in the source, it can not be compared by pointer
+		++ctx->uninterned;
+		return token->value;
+	} else if (token->flags & STRING_ESCAPED) {
+		char* decoded = (char*)arena_alloc(&ctx->scratch, token->len);
+		if (decoded == NULL)
+			return NULL;
+		size_t len = unescape(decoded, token->value, token->len);
+		char* key = store_key(ctx, decoded, len);
+		arena_free(&ctx->scratch, decoded);
+		return key;
+	} else
+		return store_key(ctx, token->value, token->len);
+}
 
-	if (parse_exp(ctx, tokenizer, &_exp)) {
-		goto compute_number;
-	}
-	_exp = 0;
-compute_number:
-	r = _int;
-	size_t digitsc = count_digits(_frac);
-	if (digitsc != 0)
-		_frac = _frac/power(10.0, digitsc);
-	r += _frac;
-	if (_exp != 0) {
-		r = r*power(10.0, (long)_exp);
+// scalar value of string, number or keyword token
+static bool token_value(aojls_ctx_t* ctx, json_token_t* token, bool lazy_numbers, _aojls_slot_t* value) {
+	switch (token->type) {
+	case STRING: {
+		json_string* s = token_string(ctx, token);
+		if (s == NULL)
+			return false;
+		slot_store(value, (json_value_t*)s);
+		break;
+	}
+	case NUMBER:
+		// span may point into the input window, it is converted before the next token is lexed
+		if (lazy_numbers) {
+			value->self.type = JS_NUMBER;
+			value->kind = NUM_RAW;
+			value->as.raw = append_string(ctx, token->value, token->len);
+			if (value->as.raw == NULL)
+				return false;
+		} else
+			span_to_number(token->value, token->len, token->flags, value);
+		++ctx->stats.count[JS_NUMBER];
+		break;
+	case _TRUE:
+	case _FALSE:
+		value->self.type = JS_BOOL;
+		value->as.boolean = token->type == _TRUE;
+		++ctx->stats.count[JS_BOOL];
+		break;
+	default:
+		value->self.type = JS_NULL;
+		++ctx->stats.count[JS_NULL];
+		break;
 	}
-	*num = r;
 	return true;
 }
 
-static bool parse_int(aojls_ctx_t* ctx, tokenizer_t* tokenizer, double* num) {
-	bool minus = false;
-	if (next_type(tokenizer, MINUS)) {
-		next(tokenizer);
-	}
-
-	size_t cpgr = get_current_pos(tokenizer);
-
-	char* digits = NULL;
-	char digit1 = 0;
-
-	if (parse_digit19(ctx, tokenizer, &digit1)) {
-		if (parse_digits(ctx, tokenizer, &digits)) {
-			char* newdigits = (char*)malloc(sizeof(char)*(strlen(digits)+2));
-			if (newdigits == NULL) {
-				free(digits);
-				fail(tokenizer, FAIL_ENOMEM);
-			}
-			newdigits[0] = digit1;
-			memcpy(newdigits+1, digits, strlen(digits)+1);
-			free(digits);
-			digits = newdigits;
-		} else {
-			digits = (char*)malloc(sizeof(char)*2);
-			if (digits == NULL) {
-				fail(tokenizer, FAIL_ENOMEM);
-			}
-			digits[0] = digit1;
-			digits[1] = '\0';
+static bool fill_container(aojls_ctx_t* ctx, json_value_t* container, _aojls_member_t* children, size_t n) {
+	// children are all known, storage is allocated at exact size and keys are moved, not copied
+	if (container->type == JS_OBJECT) {
+		json_object* o = (json_object*)container;
+		if (n > 0) {
+			o->members = (_aojls_member_t*)arena_alloc(&ctx->arena, n*sizeof(_aojls_member_t));
+			if (o->members == NULL)
+				return false;
+			memcpy(o->members, children, n*sizeof(_aojls_member_t));
 		}
-
-		double r = strtod(digits, NULL);
-		if (minus) {
-			*num = -r;
-		} else {
-			*num = r;
+		o->allocated = n;
+		o->n = n;
+	} else {
+		json_array* a = (json_array*)container;
+		if (n > 0) {
+			a->elements = (_aojls_slot_t*)arena_alloc(&ctx->arena, n*sizeof(_aojls_slot_t));
+			if (a->elements == NULL)
+				return false;
+			for (size_t i=0; i<n; i++)
+				a->elements[i] = children[i].value;
 		}
-		free(digits);
-		return true;
-	}
-
-	set_current_pos(tokenizer, cpgr);
-	if (parse_digit(ctx, tokenizer, &digit1)) {
-		*num = 0.0;
-		return true;
+		a->allocated = n;
+		a->n = n;
 	}
-
-	return false;
+	return true;
 }
 
-static bool parse_fract(aojls_ctx_t* ctx, tokenizer_t* tokenizer, double* num) {
-	if (!next_type(tokenizer, DOT)) {
-		return false;
-	}
-
-	next(tokenizer); // eat dot
-	char* digits;
-	if (parse_digits(ctx, tokenizer, &digits)) {
-		*num = strtod(digits, NULL);
-		free(digits);
-		return true;
+static json_value_t* make_container(aojls_ctx_t* ctx, json_type_t type, _aojls_document_t* doc, size_t span) {
+	// container is empty, or unloaded if doc is set
+	if (type == JS_OBJECT) {
+		json_object* o = (json_object*)make_value(ctx, sizeof(json_object), JS_OBJECT);
+		if (o == NULL)
+			return NULL;
+		o->ctx = ctx;
+		o->doc = doc;
+		o->span = span;
+		return &o->self;
+	} else {
+		json_array* a = (json_array*)make_value(ctx, sizeof(json_array), JS_ARRAY);
+		if (a == NULL)
+			return NULL;
+		a->ctx = ctx;
+		a->doc = doc;
+		a->span = span;
+		return &a->self;
 	}
+}
 
-	return false;
+static inline int parse_error(tokenizer_t* tokenizer, int status) {
+	// lexer failure is the real cause if there was one
+	return tokenizer->status != 0 ? tokenizer->status : status;
 }
 
-static bool parse_exp(aojls_ctx_t* ctx, tokenizer_t* tokenizer, double* num) {
-	bool minus = false;
+static inline size_t bracket_offset(tokenizer_t* tokenizer, size_t len) {
+	// offset of the bracket token just lexed from single chunk source of length len
+	return tokenizer->readc == 1 ? tokenizer->in.pos - 2 : len - 1;
+}
 
-	if (next_type(tokenizer, E)) {
-		next(tokenizer); // eat e/E
+// where suspended parse continues
+#define PS_VALUE 0
+#define PS_OPEN 1
+#define PS_AFTER_VALUE 2
+#define PS_KEY 3
+#define PS_COLON 4
 
-		if (next_type(tokenizer, PLUS)) {
-			next(tokenizer);
-		} else if (next_type(tokenizer, MINUS)) {
-			next(tokenizer);
-			minus = true;
+typedef struct {
+	int state; // PS_* to continue from
+	_aojls_arena_t* scratch; // stacks are kept here
+	size_t max_depth;
+	bool lazy_numbers;
+	_aojls_document_t* doc; // if set, document is only indexed
+	_frame_t* frames;
+	size_t depth;
+	size_t fcap;
+	_aojls_member_t* staged;
+	size_t nstaged;
+	size_t scap;
+	_aojls_span_t* spans;
+	size_t nspans;
+	size_t spcap;
+} parse_state_t;
+
+static void init_parse_state(parse_state_t* p, _aojls_arena_t* scratch, aojls_deserialization_prefs* prefs,
+		_aojls_document_t* doc) {
+	memset(p, 0, sizeof(parse_state_t));
+	p->state = PS_VALUE;
+	p->scratch = scratch;
+	p->max_depth = prefs->max_depth > 0 ? prefs->max_depth : AOJLS_MAX_DEPTH;
+	p->lazy_numbers = prefs->lazy_numbers;
+	p->doc = doc;
+}
+
+// iterative one-token-lookahead parser, open containers and their parsed children are kept
+// on stacks in scratch, so scratch grows with nesting depth plus the width of open containers
+// (every child of a container is staged until it closes), tokens are not kept once parsed.
+// Returns 0 or FAIL_* status. If input runs out before the value is complete,
+// returns FAIL_SUSPENDED and continues from the same place when called again.
+// If doc is set, document is only checked and its containers are indexed, root container is
+// returned unloaded.
+static int parse(aojls_ctx_t* ctx, tokenizer_t* tokenizer, parse_state_t* p, _aojls_slot_t* result) {
+	_aojls_document_t* doc = p->doc;
+	_frame_t* frame;
+	json_token_t* token;
+	_aojls_slot_t value;
+
+	switch (p->state) {
+	case PS_OPEN:
+		goto open_container;
+	case PS_AFTER_VALUE:
+		goto after_value;
+	case PS_KEY:
+		goto parse_key;
+	case PS_COLON:
+		goto parse_colon;
+	}
+
+parse_value:
+	if ((token = peek(tokenizer)) == NULL) {
+		if (tokenizer->starved) {
+			p->state = PS_VALUE;
+			return FAIL_SUSPENDED;
+		}
+		goto missing_value;
+	}
+	next(tokenizer);
+	switch (token->type) {
+	case STRING:
+	case NUMBER:
+	case _TRUE:
+	case _FALSE:
+	case _NULL:
+		// when indexing, values in containers are parsed when the container is loaded
+		if (doc == NULL || p->depth == 0) {
+			if (!token_value(ctx, token, p->lazy_numbers, &value))
+				return FAIL_ENOMEM;
+		}
+		break;
+	case LEFT_CURLY:
+	case LEFT_SQUARE:
+		if (p->depth == p->max_depth)
+			return FAIL_TOO_DEEP;
+		if (p->depth == p->fcap) {
+			size_t nfcap = p->fcap == 0 ? 16 : p->fcap * 2;
+			_frame_t* nframes = (_frame_t*)arena_realloc(p->scratch, p->frames,
+					sizeof(_frame_t)*p->fcap, sizeof(_frame_t)*nfcap);
+			if (nframes == NULL)
+				return FAIL_ENOMEM;
+			p->frames = nframes;
+			p->fcap = nfcap;
+		}
+		frame = &p->frames[p->depth++];
+		frame->type = token->type == LEFT_CURLY ? JS_OBJECT : JS_ARRAY;
+		frame->start = p->nstaged;
+		frame->key = NULL;
+		frame->empty = true;
+		if (doc != NULL) {
+			if (p->nspans == p->spcap) {
+				size_t nspcap = p->spcap == 0 ? 16 : p->spcap * 2;
+				_aojls_span_t* nspans = (_aojls_span_t*)arena_realloc(p->scratch, p->spans,
+						sizeof(_aojls_span_t)*p->spcap, sizeof(_aojls_span_t)*nspcap);
+				if (nspans == NULL)
+					return FAIL_ENOMEM;
+				p->spans = nspans;
+				p->spcap = nspcap;
+			}
+			frame->span = p->nspans++;
+			p->spans[frame->span].start = bracket_offset(tokenizer, doc->len);
 		}
+		goto open_container;
+	default:
+		goto missing_value;
+	}
 
-		char* digits;
-		if (parse_digits(ctx, tokenizer, &digits)) {
-			double r = strtod(digits, NULL);
-			free(digits);
-			if (minus)
-				*num = -r;
-			else
-				*num = r;
-			return true;
+value_done:
+	if (p->depth == 0) {
+		*result = value;
+		return 0;
+	}
+	frame = &p->frames[p->depth-1];
+	frame->empty = false;
+	if (doc == NULL) {
+		if (p->nstaged == p->scap) {
+			size_t nscap = p->scap == 0 ? 64 : p->scap * 2;
+			_aojls_member_t* nstaged = (_aojls_member_t*)arena_realloc(p->scratch, p->staged,
+					sizeof(_aojls_member_t)*p->scap, sizeof(_aojls_member_t)*nscap);
+			if (nstaged == NULL)
+				return FAIL_ENOMEM;
+			p->staged = nstaged;
+			p->scap = nscap;
 		}
+		p->staged[p->nstaged].key = frame->key;
+		p->staged[p->nstaged].value = value;
+		++p->nstaged;
 	}
-	return false;
-}
 
-static bool parse_digits(aojls_ctx_t* ctx, tokenizer_t* tokenizer, char** digits) {
-	size_t bfc = 16;
-	size_t len = 0;
-	char* buf = (char*)malloc(sizeof(char)*bfc);
+after_value:
+	frame = &p->frames[p->depth-1];
+	if ((token = peek(tokenizer)) == NULL && tokenizer->starved) {
+		p->state = PS_AFTER_VALUE;
+		return FAIL_SUSPENDED;
+	}
+	if (token != NULL && token->type == COMMA) {
+		next(tokenizer);
+		if (frame->type == JS_OBJECT)
+			goto parse_key;
+		goto parse_value;
+	}
+	if (token != NULL && token->type == (frame->type == JS_OBJECT ? RIGHT_CURLY : RIGHT_SQUARE)) {
+		next(tokenizer);
+		goto close_container;
+	}
+	return parse_error(tokenizer, frame->type == JS_OBJECT ? FAIL_EXPECTED_EOO : FAIL_EXPECTED_EOL);
 
-	do {
-		int cpgr = get_current_pos(tokenizer);
-		char digit;
-		if (!parse_digit(ctx, tokenizer, &digit)) {
-			set_current_pos(tokenizer, cpgr);
-			break;
+open_container:
+	frame = &p->frames[p->depth-1];
+	if ((token = peek(tokenizer)) == NULL && tokenizer->starved) {
+		p->state = PS_OPEN;
+		return FAIL_SUSPENDED;
+	}
+	if (token != NULL && token->type == (frame->type == JS_OBJECT ? RIGHT_CURLY : RIGHT_SQUARE)) {
+		next(tokenizer);
+		goto close_container;
+	}
+	if (frame->type == JS_OBJECT)
+		goto parse_key;
+	goto parse_value;
+
+close_container:
+	frame = &p->frames[--p->depth];
+	if (doc != NULL) {
+		p->spans[frame->span].end = bracket_offset(tokenizer, doc->len);
+		p->spans[frame->span].next = p->nspans;
+		if (p->depth > 0) {
+			// placeholder, containers are not built while indexing
+			value.self.type = JS_NULL;
+			goto value_done;
 		}
+		doc->spans = (_aojls_span_t*)arena_alloc(&ctx->arena, p->nspans*sizeof(_aojls_span_t));
+		if (doc->spans == NULL)
+			return FAIL_ENOMEM;
+		memcpy(doc->spans, p->spans, p->nspans*sizeof(_aojls_span_t));
+		json_value_t* root = make_container(ctx, frame->type, doc, 0);
+		if (root == NULL)
+			return FAIL_ENOMEM;
+		slot_store(&value, root);
+		goto value_done;
+	}
+	json_value_t* container = make_container(ctx, frame->type, NULL, 0);
+	if (container == NULL || !fill_container(ctx, container, p->staged + frame->start, p->nstaged - frame->start))
+		return FAIL_ENOMEM;
+	slot_store(&value, container);
+	p->nstaged = frame->start;
+	goto value_done;
+
+parse_key:
+	frame = &p->frames[p->depth-1];
+	if ((token = peek(tokenizer)) == NULL && tokenizer->starved) {
+		p->state = PS_KEY;
+		return FAIL_SUSPENDED;
+	}
+	if (token == NULL || token->type != STRING)
+		goto missing_pair;
+	if (doc == NULL) {
+		frame->key = token_key(ctx, token);
+		if (frame->key == NULL)
+			return FAIL_ENOMEM;
+	}
+	next(tokenizer);
+
+parse_colon:
+	if ((token = peek(tokenizer)) == NULL && tokenizer->starved) {
+		p->state = PS_COLON;
+		return FAIL_SUSPENDED;
+	}
+	if (token == NULL || token->type != COLON)
+		goto missing_pair;
+	next(tokenizer);
+	goto parse_value;
+
+missing_value:
+	if (p->depth == 0)
+		return parse_error(tokenizer, FAIL_NO_VALUE);
+	frame = &p->frames[p->depth-1];
+	if (frame->type == JS_OBJECT)
+		goto missing_pair;
+	// missing first value is reported as missing end of the array
+	return parse_error(tokenizer, frame->empty ? FAIL_EXPECTED_EOL : FAIL_EXPECTED_VALUE);
+
+missing_pair:
+	frame = &p->frames[p->depth-1];
+	// missing first pair is reported as missing end of the object
+	return parse_error(tokenizer, frame->empty ? FAIL_EXPECTED_EOO : FAIL_EXPECTED_PAIR);
+}
+
+static bool load_container(json_value_t* container) {
+	// parses direct children of a container indexed by on demand deserialization,
+	// nested containers are skipped using their spans and stay unloaded
+	bool object = container->type == JS_OBJECT;
+	aojls_ctx_t* ctx = object ? ((json_object*)container)->ctx : ((json_array*)container)->ctx;
+	_aojls_document_t* doc = object ? ((json_object*)container)->doc : ((json_array*)container)->doc;
+	size_t span = object ? ((json_object*)container)->span : ((json_array*)container)->span;
+	_aojls_span_t* s = &doc->spans[span];
+
+	string_buffer_data_t rd;
+	rd.data = doc->source + s->start;
+	rd.len = s->end - s->start + 1;
+	rd.offset = 0;
+	aojls_deserialization_prefs prefs;
+	memset(&prefs, 0, sizeof(aojls_deserialization_prefs));
+	prefs.ctx = ctx;
+	prefs.chunk_reader = string_reader_function;
+	prefs.reader_data = &rd;
 
-		if (len == bfc-1) {
-			size_t nbfc = bfc * 2;
-			char* nbuf = (char*)realloc(buf, sizeof(char)*nbfc);
-			if (nbuf == NULL) {
-				free(buf);
-				fail(tokenizer, FAIL_ENOMEM);
+	tokenizer_t tokenizer;
+	tokenizer.borrow = true;
+	tokenizer.insitu = false;
+	_aojls_member_t* staged = NULL;
+	size_t n = 0;
+	size_t cap = 0;
+	size_t child = span + 1;
+	json_token_type_t end = object ? RIGHT_CURLY : RIGHT_SQUARE;
+
+	// document was checked when indexed, only memory can run out here
+	bool ok = init_tokenizer(&tokenizer, &prefs, &ctx->scratch);
+	if (ok)
+		next(&tokenizer); // [ or {
+	while (ok && !next_type(&tokenizer, end)) {
+		if (n > 0)
+			next(&tokenizer); // comma
+		if (n == cap) {
+			size_t ncap = cap == 0 ? 16 : cap * 2;
+			_aojls_member_t* nstaged = (_aojls_member_t*)arena_realloc(&ctx->scratch, staged,
+					sizeof(_aojls_member_t)*cap, sizeof(_aojls_member_t)*ncap);
+			if (nstaged == NULL) {
+				ok = false;
+				break;
 			}
-			buf = nbuf;
-			bfc = nbfc;
+			staged = nstaged;
+			cap = ncap;
 		}
-		buf[len++] = digit;
-	} while (true);
-
-	buf[len] = '\0';
-	*digits = buf;
-	return true;
-}
 
-static bool parse_digit(aojls_ctx_t* ctx, tokenizer_t* tokenizer, char* digit) {
-   (void)ctx;
-	if (next_type(tokenizer, DIGIT)) {
-		json_token_t* tok = next(tokenizer);
-		*digit = tok->value[0];
-		return true;
-	}
-	return false;
-}
+		staged[n].key = NULL;
+		if (object) {
+			staged[n].key = token_key(ctx, next(&tokenizer));
+			next(&tokenizer); // colon
+			if (staged[n].key == NULL) {
+				ok = false;
+				break;
+			}
+		}
 
-static bool parse_digit19(aojls_ctx_t* ctx, tokenizer_t* tokenizer, char* digit) {
-   (void)ctx;
-	if (next_type(tokenizer, DIGIT)) {
-		json_token_t* tok = next(tokenizer);
-		*digit = tok->value[0];
-		if (*digit == 0)
-			return false;
-		return true;
+		json_token_t* token = next(&tokenizer);
+		if (token->type == LEFT_CURLY || token->type == LEFT_SQUARE) {
+			json_value_t* value = make_container(ctx, token->type == LEFT_CURLY ? JS_OBJECT : JS_ARRAY, doc, child);
+			if (value == NULL) {
+				ok = false;
+				break;
+			}
+			slot_store(&staged[n].value, value);
+			// continue right after the nested container
+			tokenizer.in.pos = doc->spans[child].end + 1 - s->start;
+			tokenizer.readc = input_next(&tokenizer.in, &tokenizer.ib);
+			child = doc->spans[child].next;
+		} else
+			ok = token_value(ctx, token, doc->lazy_numbers, &staged[n].value);
+		++n;
+	}
+
+	if (ok)
+		ok = fill_container(ctx, container, staged, n);
+	arena_reset(&ctx->scratch);
+	if (!ok) {
+		ctx->failed = true;
+		return false;
 	}
-	return false;
+	if (object)
+		((json_object*)container)->doc = NULL;
+	else
+		((json_array*)container)->doc = NULL;
+	return true;
 }
 
-static json_value_t* deserialize(aojls_deserialization_prefs* prefs) {
-	size_t tlen = 0;
-	json_token_t* tokenstream = create_token_stream(prefs, &tlen);
-	if (tokenstream == NULL) {
-		prefs->ctx->failed = true;
-		return NULL;
+static void set_parse_error(aojls_deserialization_prefs* prefs, int status) {
+	switch (status) {
+	case FAIL_ENOMEM:
+		prefs->error = "failed to parse json due to no memory";
+		break;
+	case FAIL_EXPECTED_PAIR:
+		prefs->error = "failed to parse json due to wrong token sequence, expected pair, got something else";
+		break;
+	case FAIL_EXPECTED_VALUE:
+		prefs->error = "failed to parse json due to wrong token sequence, expected value, got something else";
+		break;
+	case FAIL_EXPECTED_EOO:
+		prefs->error = "failed to parse json due to wrong token sequence, expected }, got something else";
+		break;
+	case FAIL_EXPECTED_EOL:
+		prefs->error = "failed to parse json due to wrong token sequence, expected ], got something else";
+		break;
+	case FAIL_NO_VALUE:
+		prefs->error = "failed to parse json tokenstream";
+		break;
+	case FAIL_TOO_DEEP:
+		prefs->error = "failed to parse json due to too deep nesting of objects and arrays";
+		break;
+	case FAIL_TOKENSTREAM:
+		// error was set by the lexer
+		break;
+	}
+}
+
+// source is only passed for on demand deserialization
+static json_value_t* deserialize(aojls_deserialization_prefs* prefs, bool borrow, bool insitu, char* source, size_t len) {
+	_aojls_document_t* doc = NULL;
+	if (source != NULL) {
+		doc = (_aojls_document_t*)arena_alloc(&prefs->ctx->arena, sizeof(_aojls_document_t));
+		if (doc == NULL) {
+			prefs->error = "failed to parse json due to no memory";
+			goto error;
+		}
+		doc->source = source;
+		doc->len = len;
+		doc->spans = NULL;
+		doc->lazy_numbers = prefs->lazy_numbers;
 	}
 
 	tokenizer_t tokenizer;
-	tokenizer.tokenstream = tokenstream;
-	tokenizer.cpos = 0;
-	tokenizer.total = tlen;
+	tokenizer.borrow = borrow || insitu;
+	tokenizer.insitu = insitu;
+	if (!init_tokenizer(&tokenizer, prefs, &prefs->ctx->scratch)) {
+		prefs->error = "tokenstream: memory error";
+		goto error;
+	}
 
+	_aojls_slot_t slot;
 	json_value_t* result;
-	int ff;
-	if ((ff = setjmp(tokenizer.jmppos)) == 0) {
-		if (!parse_value(prefs->ctx, &tokenizer, &result)) {
-			prefs->error = "failed to parse json tokenstream";
-			goto error;
-		}
-	} else {
-		switch (ff) {
-		case FAIL_ENOMEM:
-			prefs->error = "failed to parse json due to no memory";
-			break;
-		case FAIL_EXPECTED_PAIR:
-			prefs->error = "failed to parse json due to wrong token sequence, expected pair, got something else";
-			break;
-		case FAIL_EXPECTED_VALUE:
-			prefs->error = "failed to parse json due to wrong token sequence, expected value, got something else";
-			break;
-		case FAIL_EXPECTED_EOO:
-			prefs->error = "failed to parse json due to wrong token sequence, expected }, got something else";
-			break;
-		case FAIL_EXPECTED_EOL:
-			prefs->error = "failed to parse json due to wrong token sequence, expected ], got something else";
-			break;
-		}
+	parse_state_t state;
+	init_parse_state(&state, &prefs->ctx->scratch, prefs, doc);
+	int ff = parse(prefs->ctx, &tokenizer, &state, &slot);
+	if (ff == 0) {
+		// rest of the input must still be valid tokens
+		while (has_next(&tokenizer))
+			next(&tokenizer);
+		ff = tokenizer.status;
+	}
+	if (ff != 0) {
+		set_parse_error(prefs, ff);
 		goto error;
 	}
 
-	for (size_t i=0; i<tlen; i++)
-		free(tokenstream[i].value);
-	free(tokenstream);
+	result = slot_detach(prefs->ctx, &slot);
+	arena_reset(&prefs->ctx->scratch);
 	prefs->error = NULL;
 	return result;
 error:
-	for (size_t i=0; i<tlen; i++)
-		free(tokenstream[i].value);
-	free(tokenstream);
+	arena_reset(&prefs->ctx->scratch);
 	prefs->ctx->failed = true;
 	return NULL;
 }
@@ -1909,39 +3779,37 @@ error:
 aojls_ctx_t* aojls_deserialize(char* source, size_t len, aojls_deserialization_prefs* prefs) {
 	aojls_deserialization_prefs p;
 	if (prefs == NULL) {
-		p.ctx = NULL;
-		p.reader = NULL;
-		p.reader_data = NULL;
+		memset(&p, 0, sizeof(aojls_deserialization_prefs));
 	} else {
 		p = *prefs;
 	}
 
 	if (p.ctx == NULL) {
-		p.ctx = json_make_context();
+		p.ctx = json_make_context_with_allocator(p.allocator);
 		if (p.ctx == NULL) {
 			return NULL;
 		}
 	}
 
+	string_buffer_data_t rd;
 	bool selfbuffer = false;
-	if (p.reader == NULL) {
+	if (p.reader == NULL && p.chunk_reader == NULL) {
 		selfbuffer = true;
-		p.reader = string_reader_function;
-		string_buffer_data_t* rd = (string_buffer_data_t*)malloc(sizeof(string_buffer_data_t));
-		if (rd == NULL) {
-			p.ctx->failed = true;
-			return p.ctx;
-		}
-		rd->data = source;
-		rd->len = len;
-		rd->offset = 0;
-		p.reader_data = rd;
+		p.chunk_reader = string_reader_function;
+		rd.data = source;
+		rd.len = len;
+		rd.offset = 0;
+		p.reader_data = &rd;
 	}
 
-	p.ctx->result = deserialize(&p);
+	// whole source is lent as one chunk, so strings and on demand containers may point into it
+	bool on_demand = selfbuffer && p.on_demand;
+	p.ctx->result = deserialize(&p, selfbuffer && (p.borrow_source || on_demand),
+			selfbuffer && p.insitu && !on_demand, on_demand ? source : NULL, len);
 
 	if (selfbuffer) {
-		free(p.reader_data);
+		p.chunk_reader = NULL;
+		p.reader_data = NULL;
 	}
 
 	if (prefs != NULL) {
@@ -1950,3 +3818,162 @@ aojls_ctx_t* aojls_deserialize(char* source, size_t len, aojls_deserialization_p
 
 	return p.ctx;
 }
+
+/* push parser */
+
+struct aojls_parser {
+	aojls_deserialization_prefs prefs; // copy used by the tokenizer
+	aojls_deserialization_prefs* user_prefs; // ctx and error are written back on finish
+	tokenizer_t tokenizer;
+	parse_state_t state;
+	_aojls_arena_t scratch; // parser stacks and token text, they must survive between chunks
+	char* pending; // input that was not consumed yet, starts with the unfinished token
+	size_t len;
+	size_t capacity;
+	bool final; // no more input will come
+	bool done; // root value is parsed, rest of the input is only checked
+	int status;
+	_aojls_slot_t result;
+};
+
+static long push_reader_function(const char** chunk, void* reader_data) {
+	// pending input is the window of every run, running out of it means waiting for next chunk
+	aojls_parser_t* parser = (aojls_parser_t*)reader_data;
+	if (!parser->final)
+		parser->tokenizer.starved = true;
+	*chunk = NULL;
+	return 0;
+}
+
+static void parser_run(aojls_parser_t* parser) {
+	tokenizer_t* tokenizer = &parser->tokenizer;
+	input_t* in = &tokenizer->in;
+	in->data = parser->pending;
+	in->len = parser->len;
+	in->pos = 0;
+	tokenizer->starved = false;
+	tokenizer->has_token = false;
+	tokenizer->readc = input_next(in, &tokenizer->ib);
+
+	int ff = 0;
+	if (!parser->done) {
+		ff = parse(parser->prefs.ctx, tokenizer, &parser->state, &parser->result);
+		parser->done = ff == 0;
+	}
+	if (parser->done) {
+		while (has_next(tokenizer))
+			next(tokenizer);
+		ff = tokenizer->starved ? FAIL_SUSPENDED : tokenizer->status;
+	}
+
+	if (ff == FAIL_SUSPENDED) {
+		// strings and numbers keep their text in the tokenizer, only short keyword cut by the end
+		// of the chunk is kept to be lexed again, everything else was consumed
+		size_t mark = tokenizer->mark != NO_MARK ? tokenizer->mark : parser->len;
+		memmove(parser->pending, parser->pending + mark, parser->len - mark);
+		parser->len -= mark;
+	} else {
+		parser->status = ff;
+		parser->len = 0;
+	}
+}
+
+aojls_parser_t* aojls_parser_new(aojls_deserialization_prefs* prefs) {
+	aojls_deserialization_prefs p;
+	if (prefs == NULL) {
+		memset(&p, 0, sizeof(aojls_deserialization_prefs));
+	} else {
+		p = *prefs;
+	}
+
+	bool own_ctx = p.ctx == NULL;
+	if (own_ctx) {
+		p.ctx = json_make_context_with_allocator(p.allocator);
+		if (p.ctx == NULL) {
+			return NULL;
+		}
+	}
+
+	aojls_parser_t* parser = (aojls_parser_t*)mem_calloc(&p.ctx->allocator, sizeof(aojls_parser_t));
+	if (parser == NULL) {
+		goto error;
+	}
+	parser->prefs = p;
+	parser->prefs.reader = NULL;
+	parser->prefs.chunk_reader = push_reader_function;
+	parser->prefs.reader_data = parser;
+	parser->prefs.error = NULL;
+	parser->user_prefs = prefs;
+	parser->scratch.allocator = &p.ctx->allocator;
+
+	parser->tokenizer.borrow = false;
+	parser->tokenizer.insitu = false;
+	if (!init_tokenizer(&parser->tokenizer, &parser->prefs, &parser->scratch)) {
+		arena_release(&parser->scratch);
+		mem_free(&p.ctx->allocator, parser);
+		goto error;
+	}
+	init_parse_state(&parser->state, &parser->scratch, &parser->prefs, NULL);
+	return parser;
+error:
+	if (own_ctx) {
+		json_free_context(p.ctx);
+	}
+	return NULL;
+}
+
+bool aojls_parser_feed(aojls_parser_t* parser, const char* buf, size_t len) {
+	if (parser->status != 0)
+		return false;
+	if (len == 0)
+		return true;
+
+	if (parser->capacity - parser->len < len) {
+		size_t capacity = parser->capacity;
+		if (capacity == 0)
+			capacity = parser->prefs.read_buffer_size > 0 ? parser->prefs.read_buffer_size : AOJLS_READ_BUFFER_SIZE;
+		while (capacity - parser->len < len)
+			capacity *= 2;
+		char* pending = (char*)mem_realloc(&parser->prefs.ctx->allocator, parser->pending, capacity);
+		if (pending == NULL) {
+			parser->status = FAIL_ENOMEM;
+			return false;
+		}
+		parser->pending = pending;
+		parser->capacity = capacity;
+	}
+	memcpy(parser->pending + parser->len, buf, len);
+	parser->len += len;
+
+	parser_run(parser);
+	return parser->status == 0;
+}
+
+aojls_ctx_t* aojls_parser_finish(aojls_parser_t* parser) {
+	aojls_deserialization_prefs* prefs = &parser->prefs;
+	aojls_ctx_t* ctx = prefs->ctx;
+
+	if (parser->status == 0) {
+		parser->final = true;
+		parser_run(parser);
+	}
+	if (parser->status == 0) {
+		ctx->result = slot_detach(ctx, &parser->result);
+		prefs->error = NULL;
+	} else {
+		set_parse_error(prefs, parser->status);
+		ctx->result = NULL;
+		ctx->failed = true;
+	}
+	arena_reset(&ctx->scratch);
+
+	if (parser->user_prefs != NULL) {
+		parser->user_prefs->ctx = ctx;
+		parser->user_prefs->error = prefs->error;
+	}
+
+	arena_release(&parser->scratch);
+	mem_free(&ctx->allocator, parser->pending);
+	mem_free(&ctx->allocator, parser);
+	return ctx;
+}
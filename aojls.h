@@ -45,6 +45,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 #ifndef AOJLS_OBJECT_START_ALLOC_SIZE
 #define AOJLS_OBJECT_START_ALLOC_SIZE 16
@@ -54,6 +55,26 @@
 #define AOJLS_ARRAY_START_ALLOC_SIZE 16
 #endif
 
+#ifndef AOJLS_STRING_INLINE_SIZE
+#define AOJLS_STRING_INLINE_SIZE 16
+#endif
+
+#ifndef AOJLS_ARENA_CHUNK_SIZE
+#define AOJLS_ARENA_CHUNK_SIZE 4096
+#endif
+
+#ifndef AOJLS_ARENA_MAX_CHUNK_SIZE
+#define AOJLS_ARENA_MAX_CHUNK_SIZE (1024*1024)
+#endif
+
+#ifndef AOJLS_READ_BUFFER_SIZE
+#define AOJLS_READ_BUFFER_SIZE 4096
+#endif
+
+#ifndef AOJLS_MAX_DEPTH
+#define AOJLS_MAX_DEPTH 1024
+#endif
+
 /**
  * @brief JSON value tags
  *
@@ -71,12 +92,18 @@ typedef enum {
 
 /**
  * @brief AOJLS Context object, holding all memory references to JSON values and strings
+ *
+ * Values and strings are allocated from chunks owned by the context. Chunks start at
+ * AOJLS_ARENA_CHUNK_SIZE bytes and double up to AOJLS_ARENA_MAX_CHUNK_SIZE.
  */
 typedef struct aojls_ctx aojls_ctx_t;
 /**
  * @brief Unified type for any JSON value.
  *
  * All JSON value references can be casted into this.
+ *
+ * JSON objects and arrays store numbers, booleans and nulls inline. References to such values obtained
+ * from a container point into the container itself and are distinct from the value originally added.
  */
 typedef struct json_value json_value_t;
 /**
@@ -99,11 +126,15 @@ typedef struct json_array json_array;
 /**
  * @brief JSON string
  *
- * immutable, also string value is also tracked by context
+ * immutable, also string value is also tracked by context. Strings shorter than AOJLS_STRING_INLINE_SIZE
+ * are stored inline in the value, longer ones right after it. Strings deserialized with
+ * aojls_deserialization_prefs.borrow_source point into the source instead.
  */
 typedef struct json_string json_string;
 /**
  * @brief JSON number
+ *
+ * Integers that fit int64_t or uint64_t are stored exactly, other numbers as double.
  */
 typedef struct json_number json_number;
 /**
@@ -166,10 +197,25 @@ json_array* json_as_array(json_value_t* value);
  * @see json_get_type
  */
 double json_as_number(json_value_t* value, bool* correct_type);
+/**
+ * @brief Converts reference to 64 bit integer value
+ *
+ * Integers in the source are kept exactly, so values above 2^53 do not lose precision. Returns 0 and
+ * sets @p correct_type to false if JSON value is invalid, not a number or a number that is not an
+ * integer in range of int64_t, otherwise @p correct_type is set to true.
+ *
+ * @param value JSON value
+ * @param correct_type, if not NULL, state of conversion is stored there
+ * @returns integer value or 0 if invalid
+ * @see json_number
+ * @see json_get_type
+ */
+int64_t json_as_int64(json_value_t* value, bool* correct_type);
 /**
  * @brief Converts reference to string
  *
- * Returns NULL if string is invalid.
+ * Returns NULL if string is invalid. String borrowed from deserialization source is copied into
+ * its context on first call.
  *
  * @param value JSON value
  * @returns char* string or NULL if invalid
@@ -179,6 +225,20 @@ double json_as_number(json_value_t* value, bool* correct_type);
  *          when context is freed.
  */
 char* json_as_string(json_value_t* value);
+/**
+ * @brief Converts reference to string and its length
+ *
+ * Returns NULL if string is invalid. Unlike json_as_string, returned string does not need to be
+ * null terminated, so strings borrowed from deserialization source are returned without copying.
+ *
+ * @param value JSON value
+ * @param len if not NULL, length of the string is stored there
+ * @returns string or NULL if invalid
+ * @see json_string
+ * @see json_as_string
+ * @warning Do not deallocate this returned string in any way.
+ */
+const char* json_as_nstring(json_value_t* value, size_t* len);
 /**
  * @brief Converts reference to boolean
  *
@@ -202,6 +262,21 @@ bool json_as_bool(json_value_t* value, bool* correct_type);
  * @warning returns false if reference passed into json_is_null is NULL itself!
  */
 bool json_is_null(json_value_t* value);
+/**
+ * @brief Creates deep copy of @p value in context @p ctx.
+ *
+ * Copies whole subtree in one pass into single contiguous block of @p ctx. Copied JSON objects and
+ * arrays have exactly the capacity needed for their contents. @p value may be bound to any context,
+ * including @p ctx itself.
+ *
+ * Failure is marked in @p ctx.
+ *
+ * @param ctx context to which the copy will be bound
+ * @param value JSON value to copy
+ * @return copy of @p value or NULL in case of failure
+ * @warning Any cycles in nested JSON values will cause stack overflow!
+ */
+json_value_t* json_value_clone(aojls_ctx_t* ctx, json_value_t* value);
 
 /* Object */
 
@@ -262,9 +337,13 @@ char* json_object_get_key(json_object* o, size_t i);
  * O(N) complexity where N is number of keys in this JSON object.
  * Keys are compared via strcmp.
  *
+ * If key interning is enabled for the context (and was enabled for all keys in it), key is looked up
+ * once in the context and keys are then compared by pointer.
+ *
  * @param o JSON object
  * @param key
  * @return JSON value bound to that key or NULL in case of an error or no such key in this JSON object
+ * @see json_context_set_key_interning
  */
 json_value_t* json_object_get_object_as_value(json_object* o, const char* key);
 /**
@@ -301,6 +380,28 @@ double json_object_get_double(json_object* o, const char* key, bool* valid);
  * @see json_object_get_key
  */
 double json_object_get_double_default(json_object* o, const char* key, double defval);
+/**
+ * @brief Returns 64 bit integer bound to this key.
+ * @param o JSON object
+ * @param key key
+ * @param valid will contain true if position is valid and JSON integer is at that position or false
+ * @return integer bound to that key or 0 in case of an error, if there is no such key or if key points to
+ * other than JSON number JSON value or to a number that is not an int64_t integer.
+ * @see json_object_get_key
+ * @see json_as_int64
+ */
+int64_t json_object_get_int64(json_object* o, const char* key, bool* valid);
+/**
+ * @brief Returns 64 bit integer bound to this key or default value.
+ * @param o JSON object
+ * @param key key
+ * @param defval default value
+ * @return integer bound to that key or @p defval in case of an error, if there is no such key or if key points to
+ * other than JSON number JSON value or to a number that is not an int64_t integer.
+ * @see json_object_get_key
+ * @see json_as_int64
+ */
+int64_t json_object_get_int64_default(json_object* o, const char* key, int64_t defval);
 /**
  * @brief Returns string bound to this key.
  * @param o JSON object
@@ -410,6 +511,25 @@ double json_array_get_double(json_array* a, size_t i, bool* valid);
  * @see json_array_get
  */
 double json_array_get_double_default(json_array* a, size_t i, double defval);
+/**
+ * @brief Returns 64 bit integer in JSON array at position @p i.
+ * @param a array
+ * @param i position
+ * @param valid will contain true if position is valid and JSON integer is at that position or false
+ * @return integer or 0 if position is invalid or there is no int64_t integer at that position
+ * @see json_array_get
+ * @see json_as_int64
+ */
+int64_t json_array_get_int64(json_array* a, size_t i, bool* valid);
+/**
+ * @brief Returns 64 bit integer in JSON array at position @p i or default value
+ * @param a array
+ * @param i position
+ * @param defval returned in case of failure
+ * @see json_array_get
+ * @see json_as_int64
+ */
+int64_t json_array_get_int64_default(json_array* a, size_t i, int64_t defval);
 /**
  * @brief Returns string in JSON array at position @p i.
  * @param a array
@@ -485,10 +605,23 @@ json_string* json_from_string(aojls_ctx_t* ctx, char* string);
  * @see json_context_error_happened
  */
 json_number* json_from_number(aojls_ctx_t* ctx, double number);
+/**
+ * @brief Creates JSON number from 64 bit integer @p number.
+ *
+ * Number is stored exactly and serialized as integer. Failure is marked in @p ctx.
+ *
+ * @param ctx context to which this JSON number will be bound
+ * @param number value
+ * @return json_number reference or NULL in case of failure
+ * @see json_object
+ * @see aojls_ctx_t
+ * @see json_context_error_happened
+ */
+json_number* json_from_int64(aojls_ctx_t* ctx, int64_t number);
 /**
  * @brief Creates JSON boolean from @p b.
  *
- * Failure is marked in @p ctx.
+ * Every context holds single true and single false value, which are returned by every call.
  *
  * @param ctx context to which this JSON boolean will be bound
  * @param b boolean value
@@ -501,7 +634,7 @@ json_boolean* json_from_boolean(aojls_ctx_t* ctx, bool b);
 /**
  * @brief Creates JSON null
  *
- * Failure is marked in @p ctx.
+ * Every context holds single null value, which is returned by every call.
  *
  * @param ctx context to which this JSON boolean will be bound
  * @return json_boolean reference or NULL in case of failure
@@ -511,6 +644,44 @@ json_boolean* json_from_boolean(aojls_ctx_t* ctx, bool b);
  */
 json_null* json_make_null(aojls_ctx_t* ctx);
 
+/* Memory */
+
+/**
+ * @brief Custom allocation callback
+ *
+ * Must return pointer to at least @p size bytes suitably aligned for any type, or NULL on failure.
+ * @p allocator_data is user provided allocator state
+ * @see aojls_allocator_t
+ */
+typedef void*(*malloc_function_t)(size_t size, void* allocator_data);
+/**
+ * @brief Custom reallocation callback
+ *
+ * Same semantics as realloc. @p ptr is always pointer previously returned by the same allocator.
+ * @see aojls_allocator_t
+ */
+typedef void*(*realloc_function_t)(void* ptr, size_t size, void* allocator_data);
+/**
+ * @brief Custom deallocation callback
+ *
+ * @p ptr is always non-NULL pointer previously returned by the same allocator.
+ * @see aojls_allocator_t
+ */
+typedef void(*free_function_t)(void* ptr, void* allocator_data);
+
+/**
+ * @brief Allocator hooks
+ *
+ * Routes all memory used by a context, or by serialization/deserialization, to user functions.
+ * All three functions must be provided.
+ */
+typedef struct {
+	malloc_function_t malloc_function; /**< Allocation function */
+	realloc_function_t realloc_function; /**< Reallocation function */
+	free_function_t free_function; /**< Deallocation function */
+	void* allocator_data; /**< Allocator state passed to every call of the functions above */
+} aojls_allocator_t;
+
 /* Context */
 
 /**
@@ -522,6 +693,17 @@ json_null* json_make_null(aojls_ctx_t* ctx);
  * @return NULL on failure or reference to new context
  */
 aojls_ctx_t* json_make_context();
+/**
+ * @brief Creates new AOJLS context using custom allocator.
+ *
+ * Same as json_make_context, but context itself, all values and strings bound to it and any temporary
+ * buffers used by deserialization into it are allocated through @p allocator.
+ *
+ * @param allocator allocator hooks, copied into the context. If NULL, malloc/realloc/free are used
+ * @return NULL on failure or reference to new context
+ * @see aojls_allocator_t
+ */
+aojls_ctx_t* json_make_context_with_allocator(const aojls_allocator_t* allocator);
 /**
  * @brief Whether any error is detected while manipulating with this context or values bound to it.
  *
@@ -535,11 +717,77 @@ bool json_context_error_happened(aojls_ctx_t* ctx);
  * @warning if same context is used in multiple deserialization, the result will be overwritten!
  */
 json_value_t* json_context_get_result(aojls_ctx_t* ctx);
+/**
+ * @brief Enables or disables key interning for the context
+ *
+ * When enabled, every key added to JSON objects in this context (including keys created by deserialization)
+ * is stored only once per context and identical keys share the same string. If keys were only ever added
+ * while interning was enabled, key lookup only compares pointers. Interning is disabled by default.
+ *
+ * @param ctx context
+ * @param intern whether to intern keys
+ * @see json_object_get_object_as_value
+ */
+void json_context_set_key_interning(aojls_ctx_t* ctx, bool intern);
+/**
+ * @brief Freezes result of the context into single contiguous block
+ *
+ * Rewrites the result tree into single block of memory laid out depth first: every JSON object or array is
+ * followed by its exactly sized key/value storage, keys are stored next to their values and subtrees
+ * follow in order. All other memory of values and temporary buffers of deserialization is released.
+ * Reading and serializing frozen document is then linear scan through memory. All accessors work on frozen values as before, however, no
+ * values can be added to JSON objects or arrays in frozen context anymore (such attempts fail).
+ *
+ * @param ctx context with result
+ * @return true if context is frozen, false if there is no result or in case of failure (context is
+ * then left unchanged)
+ * @warning All references to values in this context obtained before freezing are invalid afterwards,
+ * use json_context_get_result to get the frozen result.
+ * @see json_context_reset
+ */
+bool json_context_freeze(aojls_ctx_t* ctx);
+/**
+ * @brief Memory and value statistics of a context
+ *
+ * @see json_context_stats
+ */
+typedef struct {
+	size_t count[INVALID]; /**< Number of values created in the context, indexed by json_type_t */
+	size_t string_bytes; /**< Total length of all JSON string values stored in the context, borrowed strings are not counted */
+	size_t key_bytes; /**< Total length of all stored keys (with key interning, each distinct key is counted once), keys left in source by in situ parsing are not counted */
+	size_t container_slack; /**< Allocated but unused slots in all JSON objects and arrays */
+	size_t used_bytes; /**< Bytes handed out to values, strings and containers */
+	size_t total_bytes; /**< All bytes held by the context, including unused parts of its memory chunks */
+} aojls_ctx_stats_t;
+
+/**
+ * @brief Reports statistics of the context
+ *
+ * Counts include all values created in this context since it was made or reset, whether by deserialization
+ * or by API calls.
+ *
+ * @param ctx context
+ * @param stats filled with statistics of @p ctx
+ * @return false if @p ctx or @p stats is NULL, true otherwise
+ * @see aojls_ctx_stats_t
+ */
+bool json_context_stats(aojls_ctx_t* ctx, aojls_ctx_stats_t* stats);
+/**
+ * @brief Drops all values bound to the context, but keeps its memory for reuse
+ *
+ * Clears error state, frozen state and result of last deserialization. Memory held by the context is kept
+ * (coalesced into single block), so subsequent workload of the same size, including
+ * deserialization into this context, does not need to allocate anything.
+ *
+ * @param ctx context to reset
+ * @warning After this operation, all references to any values in this context is undefined!
+ */
+void json_context_reset(aojls_ctx_t* ctx);
 /**
  * @brief frees the context and all bound values
  *
  * Frees all the memory used by all bound values in this context, all strings used by those values and then
- * context itself.
+ * context itself. Since all of those are allocated from the context's chunks, only the chunks are freed.
  * @warning After this operation, all references to any values in this context is undefined!
  */
 void json_free_context(aojls_ctx_t* ctx);
@@ -559,7 +807,8 @@ typedef bool(*writer_function_t)(const char* buffer, size_t len, void* writer_da
  * @brief Serialization preferences
  *
  * Contains all available preferences that can be used by serialization. Also holds result of
- * serialization where they were used.
+ * serialization where they were used. Fields that are not used must be zeroed (e.g. by memset), so that
+ * preferences added in later versions keep their defaults.
  */
 typedef struct {
 	bool pretty; /**< Whether pretty output is required (newlines, indentation), default is false */
@@ -569,6 +818,8 @@ typedef struct {
 
 	writer_function_t writer; /**< Custom writer function. If not provided, serializer will output to string */
 	void* writer_data; /**< Writer state. Only applicable when custom writer is used, otherwise should be NULL. */
+	bool use_allocator; /**< If true, allocator is used, otherwise allocator is not read at all */
+	const aojls_allocator_t* allocator; /**< Allocator for temporary buffers and returned string, only used if use_allocator is true. If NULL, malloc/realloc/free are used */
 
 	bool success; /**< true if serialization was successful, false if not */
 } aojls_serialization_prefs;
@@ -584,7 +835,9 @@ typedef struct {
  * @return serialized value or NULL
  * @see aojls_serialization_prefs
  * @warning Any cycles in nested JSON values will cause stack overflow!
- * @warning If returned string is non-NULL, it must be freed by calling free when it is not needed!
+ * @warning If returned string is non-NULL, it must be freed by calling free when it is not needed! If custom
+ * allocator was specified in @p prefs (and aojls_serialization_prefs.use_allocator was set), its free function
+ * must be used instead.
  */
 char* aojls_serialize(json_value_t* value, aojls_serialization_prefs* prefs);
 
@@ -593,30 +846,50 @@ char* aojls_serialize(json_value_t* value, aojls_serialization_prefs* prefs);
 /**
  * @brief Custom deserialization callback
  *
- * This callback is called each time deserializer needs to read new data.
+ * This callback is called each time deserializer needs to read new data. Deserializer asks for whole
+ * blocks of aojls_deserialization_prefs.read_buffer_size bytes, but callback may return less.
  * This callback must return number of bytes actually read in the buffer and it must be <= len, or
  * negative in case of failure. If 0 is returned, deserializer considers that as EOF.
  */
 typedef long(*reader_function_t)(char* buffer, size_t len, void* reader_data);
 
+/**
+ * @brief Custom deserialization callback lending data in place
+ *
+ * This callback is called each time deserializer needs to read new data. Instead of copying data,
+ * callback stores pointer to the next chunk of input into @p chunk and returns its length.
+ * Chunk must stay valid and unchanged until the next call of this callback or until deserialization ends.
+ * Negative value is returned in case of failure. If 0 is returned, deserializer considers that as EOF.
+ */
+typedef long(*chunk_reader_function_t)(const char** chunk, void* reader_data);
+
 /**
  * @brief Deserialization preferences
  *
  * Contains all available preferences that can be used by deserialization. Also holds reference to any error,
- * if it has happened during the deserialization.
+ * if it has happened during the deserialization. Fields that are not used must be zeroed (e.g. by memset).
  */
 typedef struct {
 	reader_function_t reader; /**< Custom reader function. If not provided, deserializer will use string provided as source */
+	chunk_reader_function_t chunk_reader; /**< Custom chunk reader function. Takes precedence over reader, if both are provided */
 	void* reader_data; /**< Reader state. Only applicable if custom reader is used, otherwise should be NULL */
+	size_t read_buffer_size; /**< Size of the block buffer used with custom reader. If 0, AOJLS_READ_BUFFER_SIZE is used */
 
 	aojls_ctx_t* ctx; /**< If non-NULL, this context will be used by deserializer, otherwise new context will be created */
+	const aojls_allocator_t* allocator; /**< Allocator for the new context, if one is created. Temporary buffers always use allocator of the context */
+	bool borrow_source; /**< If true and no custom reader is used, JSON strings point into source instead of being copied. Source must stay valid and unchanged as long as the context. Strings with escape sequences are decoded into the context when they are first read, so such document must not be read from multiple threads at once, unless it was frozen by json_context_freeze first, which decodes all strings */
+	bool on_demand; /**< If true and no custom reader is used, whole source is checked, but values in JSON objects and arrays are only created when the container is first accessed. Implies borrow_source, insitu is ignored. Source must stay valid and unchanged as long as the context. Accessing a container for the first time creates its values in the context, so such document must not be read from multiple threads at once, unless it was frozen by json_context_freeze first, which creates all values */
+	bool lazy_numbers; /**< If true, JSON numbers keep their source text, which is converted whenever the number is read and serialized unchanged */
+	size_t max_depth; /**< Maximum nesting of JSON objects and arrays, deeper input fails to parse. If 0, AOJLS_MAX_DEPTH is used */
+	bool insitu; /**< If true and no custom reader is used, source is modified: JSON strings and keys are decoded and null terminated in place and point there. Source must stay valid as long as the context */
 	const char* error; /**< If error has happened, this will contain reference to a string containing error details, otherwise NULL */
 } aojls_deserialization_prefs;
 
 /**
  * @brief Deserialization function
  *
- * @param source string containing JSON data, may be NULL if custom reader is used instead
+ * @param source string containing JSON data, may be NULL if custom reader is used instead. Provided string
+ * is read in place, it is not copied into a buffer. It is only modified if aojls_deserialization_prefs.insitu is set
  * @param len size of previous string, if applicable
  * @param prefs preferences used for this deserialization
  * @return context where the result may be (if there was no error) or NULL if context is not provided
@@ -626,3 +899,51 @@ typedef struct {
  * @see json_free_context
  */
 aojls_ctx_t* aojls_deserialize(char* source, size_t len, aojls_deserialization_prefs* prefs);
+
+/**
+ * @brief Push parser state
+ *
+ * Created by aojls_parser_new, input is given to it in chunks by aojls_parser_feed as it arrives
+ * and the result is obtained by aojls_parser_finish.
+ */
+typedef struct aojls_parser aojls_parser_t;
+
+/**
+ * @brief Creates push parser
+ *
+ * Parser keeps its state between chunks, so input does not need to be buffered before it is parsed.
+ * Values are built into the context as the chunks arrive.
+ *
+ * @param prefs preferences used for this deserialization, may be NULL. Readers, borrow_source, on_demand and
+ * insitu are ignored. If prefs are provided, they must stay valid until aojls_parser_finish is called
+ * @return new parser or NULL if there was not enough memory
+ * @see aojls_parser_feed
+ * @see aojls_parser_finish
+ */
+aojls_parser_t* aojls_parser_new(aojls_deserialization_prefs* prefs);
+
+/**
+ * @brief Parses next chunk of input
+ *
+ * Chunk is copied, it can be reused after the call. Token split between two chunks is parsed when the rest
+ * of it arrives.
+ *
+ * @param parser push parser
+ * @param buf next chunk of JSON data
+ * @param len size of the chunk
+ * @return false if input is already known to be invalid or there was not enough memory, then rest
+ * of the input can be dropped. Error is reported by aojls_parser_finish
+ */
+bool aojls_parser_feed(aojls_parser_t* parser, const char* buf, size_t len);
+
+/**
+ * @brief Finishes parsing and frees the parser
+ *
+ * Must be called for every parser, even if aojls_parser_feed failed. If prefs were provided to aojls_parser_new,
+ * aojls_deserialization_prefs.ctx and aojls_deserialization_prefs.error are set as with aojls_deserialize.
+ *
+ * @param parser push parser, it is invalid after the call
+ * @return context where the result may be (if there was no error)
+ * @see json_context_get_result
+ */
+aojls_ctx_t* aojls_parser_finish(aojls_parser_t* parser);
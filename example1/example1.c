@@ -32,6 +32,7 @@
 
 #include <stdio.h>
 #include <stdbool.h>
+#include <string.h>
 
 int main() {
 	aojls_ctx_t* ctx = json_make_context();
@@ -57,11 +58,9 @@ int main() {
 	json_object_add(root, "key6", (json_value_t*)o);
 
 	aojls_serialization_prefs p;
-	p.eol = NULL;
+	memset(&p, 0, sizeof(aojls_serialization_prefs));
 	p.pretty = false;
 	p.offset_per_level = 4;
-	p.writer = NULL;
-	p.number_formatter = NULL;
 	p.number_formatter = "%.17g";
 
 	char* result = aojls_serialize((json_value_t*)root, &p);
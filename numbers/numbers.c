@@ -0,0 +1,220 @@
+/**
+ * Copyright (c) 2016, Peter Vanusanik
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of AOJLS nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Checks number conversion of the deserializer against strtod and measures its speed
+ * on number heavy documents.
+ *
+ * Build (from the repository root): cc -std=c99 -O2 -I. aojls.c numbers/numbers.c -o numbers/numbers -lm
+ * Usage: numbers [check|bench]    (both if no argument is given)
+ */
+
+#include <aojls.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdint.h>
+#include <float.h>
+#include <math.h>
+#include <time.h>
+
+static uint64_t random_state = 88172645463325252ULL;
+
+static uint64_t random_next(void) {
+	random_state ^= random_state << 13;
+	random_state ^= random_state >> 7;
+	random_state ^= random_state << 17;
+	return random_state;
+}
+
+/* cross-check */
+
+static size_t checked = 0;
+static size_t mismatches = 0;
+
+static void check(const char* text) {
+	char buffer[2048];
+	snprintf(buffer, sizeof(buffer), "[%s]", text);
+	aojls_ctx_t* ctx = aojls_deserialize(buffer, strlen(buffer), NULL);
+	json_value_t* result = json_context_get_result(ctx);
+
+	++checked;
+	if (result == NULL) {
+		if (mismatches++ < 10)
+			printf("failed to parse %s\n", text);
+	} else {
+		double got = json_array_get_double(json_as_array(result), 0, NULL);
+		double expected = strtod(text, NULL);
+		// compared bitwise, so that -0 and 0 differ
+		if (memcmp(&got, &expected, sizeof(double)) != 0 && mismatches++ < 10)
+			printf("mismatch %s: got %.17g, expected %.17g\n", text, got, expected);
+	}
+	json_free_context(ctx);
+}
+
+static const char* edge_cases[] = {
+	"0", "-0", "1.05", "0.1", "0.3", "1e23", "1E+2", "-12345.6789e-3", "3.141592653589793",
+	"9007199254740993", "9007199254740992.5", "7.2057594037927933e16",
+	"8.98846567431158e307", "1.7976931348623157e308", "1.7976931348623159e308", "1e400",
+	"2.2250738585072014e-308", "2.2250738585072011e-308",
+	"4.9406564584124654e-324", "2.4703282292062327e-324", "2.4703282292062328e-324", "1e-400",
+	"123456789012345678901234567890", "0.000000000000000000000000000001234567890123456789012345",
+	"1.00000000000000011102230246251565404236316680908203125",
+	"1.00000000000000011102230246251565404236316680908203124",
+	"1.00000000000000011102230246251565404236316680908203126",
+};
+
+static int run_check(void) {
+	char text[1200];
+
+	for (size_t i=0; i<sizeof(edge_cases)/sizeof(edge_cases[0]); i++)
+		check(edge_cases[i]);
+
+	// random doubles printed with various precisions, plus long and huge exponent forms
+	for (int i=0; i<2000000; i++) {
+		uint64_t bits = random_next();
+		double d;
+		memcpy(&d, &bits, sizeof(double));
+		if (isnan(d) || isinf(d))
+			continue;
+		const char* format = (i & 3) == 0 ? "%.17g" : (i & 3) == 1 ? "%.16g" : (i & 3) == 2 ? "%.20g" : "%.6g";
+		snprintf(text, sizeof(text), format, d);
+		check(text);
+		if (i % 50 == 0) {
+			snprintf(text, sizeof(text), "%.40f", d * 1e-300);
+			check(text);
+			snprintf(text, sizeof(text), "%llu.%llue%d", (unsigned long long)random_next(),
+					(unsigned long long)random_next(), (int)(random_next() % 700) - 350);
+			check(text);
+		}
+	}
+
+#if LDBL_MANT_DIG > DBL_MANT_DIG
+	// exact midpoints between neighbouring doubles, they need all their digits to round correctly
+	for (int i=0; i<2000; i++) {
+		uint64_t bits = random_next() & 0x7FEFFFFFFFFFFFFFULL;
+		double d;
+		memcpy(&d, &bits, sizeof(double));
+		long double midpoint = ((long double)d + nextafter(d, INFINITY)) / 2;
+		snprintf(text, sizeof(text), "%.800Lg", midpoint);
+		check(text);
+	}
+#endif
+
+	printf("checked %lu numbers against strtod, %lu mismatches\n", (unsigned long)checked, (unsigned long)mismatches);
+	return mismatches != 0;
+}
+
+/* benchmark */
+
+#define BENCH_NUMBERS 500000
+#define BENCH_RUNS 15
+
+static void bench_corpus(const char* name, int kind) {
+	char* document = (char*)malloc(BENCH_NUMBERS * 40 + 16);
+	double* expected = (double*)malloc(BENCH_NUMBERS * sizeof(double));
+	size_t len = 0;
+
+	document[len++] = '[';
+	for (size_t i=0; i<BENCH_NUMBERS; i++) {
+		if (i > 0)
+			document[len++] = ',';
+		switch (kind) {
+		case 0: // ids
+			len += sprintf(document + len, "%llu", (unsigned long long)(random_next() % 100000000000ULL));
+			break;
+		case 1: // prices
+			len += sprintf(document + len, "%.2f", (double)(random_next() % 1000000) / 100);
+			break;
+		case 2: // shortest round trip doubles
+			len += sprintf(document + len, "%.17g", (double)(random_next() >> 11) / 9007199254740992.0 * 1000);
+			break;
+		default: // exponent form
+			len += sprintf(document + len, "%.15e", (double)(random_next() >> 11) * 1e-200 * (double)(random_next() % 1000));
+			break;
+		}
+	}
+	document[len++] = ']';
+	document[len] = '\0';
+
+	double best = 1e9;
+	for (int run=0; run<BENCH_RUNS; run++) {
+		clock_t start = clock();
+		aojls_ctx_t* ctx = aojls_deserialize(document, len, NULL);
+		double elapsed = (double)(clock() - start) / CLOCKS_PER_SEC;
+		if (json_context_get_result(ctx) == NULL) {
+			printf("%s: failed to parse\n", name);
+			exit(1);
+		}
+		json_free_context(ctx);
+		if (elapsed < best)
+			best = elapsed;
+	}
+
+	// same numbers through strtod alone, for reference
+	double best_strtod = 1e9;
+	for (int run=0; run<BENCH_RUNS; run++) {
+		clock_t start = clock();
+		char* p = document + 1;
+		for (size_t i=0; i<BENCH_NUMBERS; i++) {
+			expected[i] = strtod(p, &p);
+			++p;
+		}
+		double elapsed = (double)(clock() - start) / CLOCKS_PER_SEC;
+		if (elapsed < best_strtod)
+			best_strtod = elapsed;
+	}
+
+	printf("%-10s %7.1f MB/s %6.1f M numbers/s   (strtod alone %6.1f M numbers/s)\n", name,
+			(double)len / 1e6 / best, BENCH_NUMBERS / 1e6 / best, BENCH_NUMBERS / 1e6 / best_strtod);
+	free(expected);
+	free(document);
+}
+
+static void run_bench(void) {
+	bench_corpus("ids", 0);
+	bench_corpus("prices", 1);
+	bench_corpus("doubles", 2);
+	bench_corpus("exponents", 3);
+}
+
+int main(int argc, char** argv) {
+	bool check_only = argc > 1 && strcmp(argv[1], "check") == 0;
+	bool bench_only = argc > 1 && strcmp(argv[1], "bench") == 0;
+
+	int result = 0;
+	if (!bench_only)
+		result = run_check();
+	if (!check_only)
+		run_bench();
+	return result;
+}
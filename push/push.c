@@ -0,0 +1,137 @@
+/**
+ * Copyright (c) 2016, Peter Vanusanik
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of AOJLS nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Checks that push parser gives the same result and error as aojls_deserialize, whichever way
+ * the input is split into chunks, and that tokens spanning many chunks cost linear time.
+ *
+ * Build (from the repository root): cc -std=c99 -O2 -I. aojls.c push/push.c -o push/push
+ */
+
+#include <aojls.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+static uint64_t random_state = 88172645463325252ULL;
+
+static uint64_t random_next(void) {
+	random_state ^= random_state << 13;
+	random_state ^= random_state >> 7;
+	random_state ^= random_state << 17;
+	return random_state;
+}
+
+static size_t failures = 0;
+
+// chunk of 0 means random sizes from 1 to 7
+static double check(const char* source, size_t len, size_t chunk, aojls_deserialization_prefs* base) {
+	aojls_deserialization_prefs dp = *base;
+	aojls_ctx_t* expected_ctx = aojls_deserialize((char*)source, len, &dp);
+	char* expected = dp.error != NULL ? NULL : aojls_serialize(json_context_get_result(expected_ctx), NULL);
+
+	aojls_deserialization_prefs pp = *base;
+	clock_t start = clock();
+	aojls_parser_t* parser = aojls_parser_new(&pp);
+	for (size_t offset=0; offset<len; ) {
+		size_t n = chunk > 0 ? chunk : (size_t)(random_next() % 7 + 1);
+		if (n > len - offset)
+			n = len - offset;
+		if (!aojls_parser_feed(parser, source + offset, n))
+			break;
+		offset += n;
+	}
+	aojls_ctx_t* ctx = aojls_parser_finish(parser);
+	double elapsed = (double)(clock() - start) / CLOCKS_PER_SEC;
+	char* result = pp.error != NULL ? NULL : aojls_serialize(json_context_get_result(ctx), NULL);
+
+	const char* expected_error = dp.error != NULL ? dp.error : "ok";
+	const char* error = pp.error != NULL ? pp.error : "ok";
+	if (strcmp(expected_error, error) != 0 || (expected != NULL && (result == NULL || strcmp(expected, result) != 0))) {
+		if (failures++ < 10)
+			printf("mismatch in %.40s... with chunk %lu: %s, expected %s\n", source, (unsigned long)chunk, error, expected_error);
+	}
+
+	free(expected);
+	free(result);
+	json_free_context(expected_ctx);
+	json_free_context(ctx);
+	return elapsed;
+}
+
+static const char* documents[] = {
+	"{\"a\" 1}", "{\"a\":1,}", "[1,]", "[}", "{\"a\":}", "{1:2}", "[1 2]", "{\"a\":1 \"b\":2}", "", "]",
+	"{\"a\":[1,{\"b\":}]}", "[{]", "[1, tru]", "[[[", "{\"a\":1", "[1,2] x", "[1,2] ]", "[1,\"abc", "{\"a\":tx}",
+	"  ", "[[],[[]],{}]", "{\"a\":{\"b\":[1,2,{}],\"c\":\"x\\n\"}}", "1234", " 12.5e3 ", "true", "null ", "fals",
+	"\"a\\u00e9\\\"b\"", "[true,false,null,-0,1e400,18446744073709551615,-12.30]", "{\"k\":\"\\x\"}", "[1,2]   \n",
+	"[1e]", "-", "[truee]", "nulll",
+};
+
+int main() {
+	aojls_deserialization_prefs prefs;
+	memset(&prefs, 0, sizeof(aojls_deserialization_prefs));
+	aojls_deserialization_prefs lazy = prefs;
+	lazy.lazy_numbers = true;
+
+	for (size_t i=0; i<sizeof(documents)/sizeof(documents[0]); i++) {
+		size_t len = strlen(documents[i]);
+		for (size_t chunk=0; chunk<4; chunk++) {
+			check(documents[i], len, chunk, &prefs);
+			check(documents[i], len, chunk, &lazy);
+		}
+	}
+
+	// multi MB string, whitespace run and number, each spanning many chunks
+	size_t size = 4 << 20;
+	char* document = (char*)malloc(size + size / 4 + 100100);
+	size_t len = sprintf(document, "{\"string\":\"");
+	for (size_t i=0; i<size; i++)
+		document[len++] = i % 1000 == 998 ? '\\' : i % 1000 == 999 ? 'n' : 'a' + i % 26;
+	len += sprintf(document + len, "\",\"number\":");
+	for (size_t i=0; i<size / 4; i++)
+		document[len++] = ' ';
+	document[len++] = '1';
+	for (size_t i=0; i<100000; i++)
+		document[len++] = '0' + i % 10;
+	document[len++] = '}';
+
+	double byte_time = check(document, len, 1, &prefs);
+	double packet_time = check(document, len, 1460, &prefs);
+	printf("%lu byte document: %.2f s fed byte by byte, %.2f s in 1460 byte chunks\n",
+			(unsigned long)len, byte_time, packet_time);
+	free(document);
+
+	printf("%lu mismatches\n", (unsigned long)failures);
+	return failures != 0;
+}